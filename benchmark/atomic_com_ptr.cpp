@@ -0,0 +1,74 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <moderncom/atomic_com_ptr.h>
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+// Readers loading a process-wide interface pointer, compared with com_ptr guarded by a lock
+
+namespace
+{
+	struct locked_ptr
+	{
+		mutable belt::srwlock lock;
+		bcom::ptr<IBench0> value;
+
+		bcom::ptr<IBench0> load() const noexcept
+		{
+			std::shared_lock l{ lock };
+			return value;
+		}
+
+		void store(bcom::ptr<IBench0> desired) noexcept
+		{
+			std::scoped_lock l{ lock };
+			std::swap(value, desired);
+		}
+	};
+
+	struct mutex_ptr
+	{
+		mutable std::mutex lock;
+		bcom::ptr<IBench0> value;
+
+		bcom::ptr<IBench0> load() const noexcept
+		{
+			std::scoped_lock l{ lock };
+			return value;
+		}
+
+		void store(bcom::ptr<IBench0> desired) noexcept
+		{
+			std::scoped_lock l{ lock };
+			std::swap(value, desired);
+		}
+	};
+
+	// With writer, thread 0 replaces the pointer every 1024 iterations while the others read
+	template<class Holder, bool writer>
+	bench::body_t load(unsigned)
+	{
+		auto holder = std::make_shared<Holder>();
+		holder->store(bench_small::create_instance().to_ptr());
+		return [holder](unsigned index, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				if (writer && index == 0 && i % 1024 == 0)
+					holder->store(bench_small::create_instance().to_ptr());
+				auto p = holder->load();
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	bench::registrar r1{ "atomic_com_ptr/load", load<bcom::atomic_ptr<IBench0>, false>, 10'000'000 };
+	bench::registrar r2{ "atomic_com_ptr/load_with_writer", load<bcom::atomic_ptr<IBench0>, true>, 10'000'000 };
+	bench::registrar r3{ "atomic_com_ptr/baseline/srwlock/load", load<locked_ptr, false>, 10'000'000 };
+	bench::registrar r4{ "atomic_com_ptr/baseline/srwlock/load_with_writer", load<locked_ptr, true>, 10'000'000 };
+	bench::registrar r5{ "atomic_com_ptr/baseline/mutex/load", load<mutex_ptr, false>, 10'000'000 };
+	bench::registrar r6{ "atomic_com_ptr/baseline/mutex/load_with_writer", load<mutex_ptr, true>, 10'000'000 };
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Reference-counted baselines to compare the library against
+
+namespace bench
+{
+	// boost::intrusive_ptr-style pointer: non-virtual atomic counter embedded in the object
+	struct intrusive_counted
+	{
+		std::atomic<int> refcount{};
+		int payload{};
+
+		friend void intrusive_ptr_add_ref(intrusive_counted *p) noexcept
+		{
+			p->refcount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		friend void intrusive_ptr_release(intrusive_counted *p) noexcept
+		{
+			if (p->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				delete p;
+		}
+	};
+
+	template<class T>
+	class intrusive_ptr
+	{
+		T *p{};
+
+	public:
+		intrusive_ptr() = default;
+
+		explicit intrusive_ptr(T *p) noexcept :
+			p{ p }
+		{
+			if (p)
+				intrusive_ptr_add_ref(p);
+		}
+
+		intrusive_ptr(const intrusive_ptr &o) noexcept :
+			intrusive_ptr{ o.p }
+		{}
+
+		intrusive_ptr(intrusive_ptr &&o) noexcept :
+			p{ std::exchange(o.p, nullptr) }
+		{}
+
+		intrusive_ptr &operator =(const intrusive_ptr &o) noexcept
+		{
+			intrusive_ptr{ o }.swap(*this);
+			return *this;
+		}
+
+		intrusive_ptr &operator =(intrusive_ptr &&o) noexcept
+		{
+			intrusive_ptr{ std::move(o) }.swap(*this);
+			return *this;
+		}
+
+		~intrusive_ptr()
+		{
+			if (p)
+				intrusive_ptr_release(p);
+		}
+
+		void swap(intrusive_ptr &o) noexcept
+		{
+			std::swap(p, o.p);
+		}
+
+		T *get() const noexcept
+		{
+			return p;
+		}
+
+		T *operator ->() const noexcept
+		{
+			return p;
+		}
+	};
+}
@@ -0,0 +1,72 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <moderncom/library.h>
+
+// Class factory requests through in-process stand-ins for the entry points of a COM DLL server, compared with creating a
+// new factory for every request. Classes are registered in creation.cpp
+
+namespace
+{
+	HRESULT DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID *ppv) noexcept
+	{
+		return belt::com::DllGetClassObject(rclsid, riid, ppv);
+	}
+
+	// What CoCreateInstance does for an in-process server that is already loaded
+	HRESULT CoCreateInstance(REFCLSID rclsid, IUnknown *pUnkOuter, REFIID riid, void **ppv) noexcept
+	{
+		IClassFactory *factory;
+		auto hr = DllGetClassObject(rclsid, belt::com::get_interface_guid<IClassFactory>(), reinterpret_cast<void **>(&factory));
+		if (FAILED(hr))
+			return hr;
+		hr = factory->CreateInstance(pUnkOuter, riid, ppv);
+		factory->Release();
+		return hr;
+	}
+
+	bench::body_t get_class_object(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				bcom::ptr<IClassFactory> factory;
+				DllGetClassObject(CLSID_BenchSmall, belt::com::get_interface_guid<IClassFactory>(), reinterpret_cast<void **>(factory.put()));
+				bench::do_not_optimize(factory);
+			}
+		};
+	}
+
+	bench::body_t co_create_instance(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				bcom::ptr<IBench0> p;
+				CoCreateInstance(CLSID_BenchSmall, nullptr, belt::com::get_interface_guid<IBench0>(), reinterpret_cast<void **>(p.put()));
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	// A factory allocated and queried for every request
+	bench::body_t new_factory(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			const auto create = belt::com::details::get_class_registry().find(CLSID_BenchSmall)->create;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				bcom::ptr<IClassFactory> factory;
+				belt::com::details::Factory::create_instance(create).to_ptr<IUnknown>()->QueryInterface(belt::com::get_interface_guid<IClassFactory>(), reinterpret_cast<void **>(factory.put()));
+				bench::do_not_optimize(factory);
+			}
+		};
+	}
+
+	bench::registrar r1{ "class_factory/DllGetClassObject", get_class_object, 20'000'000 };
+	bench::registrar r2{ "class_factory/CoCreateInstance", co_create_instance, 2'000'000 };
+	bench::registrar r3{ "class_factory/baseline/new_factory", new_factory, 2'000'000 };
+}
@@ -0,0 +1,54 @@
+#include "harness.h"
+#include "objects.h"
+
+// com_ptr copy, move and as<>() conversions
+
+namespace
+{
+	auto make_large()
+	{
+		return bench_large::create_instance().to_ptr();
+	}
+
+	void copy(const bcom::ptr<IBench0> &p) noexcept
+	{
+		auto copy = p;
+		bench::do_not_optimize(copy);
+	}
+
+	// Static conversion to a base interface, no QueryInterface involved
+	void as_base(const bcom::ptr<IBench0> &p) noexcept
+	{
+		auto unknown = p.as<IUnknown>();
+		bench::do_not_optimize(unknown);
+	}
+
+	template<class Interface>
+	void as_query(const bcom::ptr<IBench0> &p) noexcept
+	{
+		auto other = p.as<Interface>();
+		bench::do_not_optimize(other);
+	}
+
+	bench::body_t move(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			auto p = make_large();
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto moved = std::move(p);
+				bench::do_not_optimize(moved);
+				p = std::move(moved);
+			}
+		};
+	}
+
+	bench::registrar r1{ "com_ptr/copy/shared", bench::shared_object(make_large, copy), 20'000'000 };
+	bench::registrar r2{ "com_ptr/copy/private", bench::private_object(make_large, copy), 20'000'000 };
+	bench::registrar r3{ "com_ptr/move", move, 20'000'000 };
+	bench::registrar r4{ "com_ptr/as/base/shared", bench::shared_object(make_large, as_base), 20'000'000 };
+	bench::registrar r5{ "com_ptr/as/base/private", bench::private_object(make_large, as_base), 20'000'000 };
+	bench::registrar r6{ "com_ptr/as/query/shared", bench::shared_object(make_large, as_query<IBench15>), 10'000'000 };
+	bench::registrar r7{ "com_ptr/as/query/private", bench::private_object(make_large, as_query<IBench15>), 10'000'000 };
+}
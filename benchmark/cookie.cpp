@@ -0,0 +1,109 @@
+#include "harness.h"
+#include "objects.h"
+
+// Passing a leak detection cookie to the object and back, compared with the earlier TLS slot and plain thread_local
+// channels. Only built into the program when leak detection or leak sampling is compiled in
+
+#if BELT_HAS_REF_COOKIES
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace
+{
+	// Cookie stored in a TLS slot allocated at run time (TlsGetValue or pthread_getspecific)
+	struct tls_slot_channel
+	{
+#if defined(_WIN32)
+		DWORD slot{ TlsAlloc() };
+
+		void set(int cookie) const noexcept
+		{
+			TlsSetValue(slot, reinterpret_cast<void *>(static_cast<uintptr_t>(cookie)));
+		}
+
+		int get() const noexcept
+		{
+			auto value = TlsGetValue(slot);
+			TlsSetValue(slot, nullptr);
+			return static_cast<int>(reinterpret_cast<uintptr_t>(value));
+		}
+#else
+		pthread_key_t slot{};
+
+		tls_slot_channel() noexcept
+		{
+			pthread_key_create(&slot, nullptr);
+		}
+
+		void set(int cookie) const noexcept
+		{
+			pthread_setspecific(slot, reinterpret_cast<void *>(static_cast<uintptr_t>(cookie)));
+		}
+
+		int get() const noexcept
+		{
+			auto value = pthread_getspecific(slot);
+			pthread_setspecific(slot, nullptr);
+			return static_cast<int>(reinterpret_cast<uintptr_t>(value));
+		}
+#endif
+	};
+
+	// Visible to this module only
+	thread_local int module_cookie{};
+
+	struct thread_local_channel
+	{
+		void set(int cookie) const noexcept
+		{
+			module_cookie = cookie;
+		}
+
+		int get() const noexcept
+		{
+			return std::exchange(module_cookie, 0);
+		}
+	};
+
+	struct library_channel
+	{
+		void set(int cookie) const noexcept
+		{
+			belt::com::details::set_current_cookie(cookie);
+		}
+
+		int get() const noexcept
+		{
+			return belt::com::details::get_current_cookie();
+		}
+	};
+
+	// A reference is added and released: the cookie goes from the object to com_ptr and back
+	template<class Channel>
+	bench::body_t round_trip(unsigned)
+	{
+		static const Channel channel;
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				channel.set(static_cast<int>(i) | 1);
+				auto cookie = channel.get();
+				bench::do_not_optimize(cookie);
+				channel.set(cookie);
+				cookie = channel.get();
+				bench::do_not_optimize(cookie);
+			}
+		};
+	}
+
+	bench::registrar r1{ "cookie/round_trip", round_trip<library_channel>, 50'000'000 };
+	bench::registrar r2{ "cookie/baseline/tls_slot", round_trip<tls_slot_channel>, 50'000'000 };
+	bench::registrar r3{ "cookie/baseline/thread_local", round_trip<thread_local_channel>, 50'000'000 };
+}
+
+#endif
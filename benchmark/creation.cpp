@@ -0,0 +1,100 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <memory_resource>
+
+// Object creation with create_instance and with create_object by CLSID
+
+BELT_OBJ_ENTRY_AUTO2(CLSID_BenchSmall, bench_small)
+BELT_OBJ_ENTRY_AUTO2(CLSID_BenchLarge, bench_large)
+BELT_OBJ_ENTRY_AUTO2(CLSID_BenchSingleton, bench_singleton)
+BELT_OBJ_ENTRY_AUTO2(CLSID_BenchCached, bench_cached)
+
+namespace
+{
+	template<class Class>
+	bench::body_t create_instance(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto p = Class::create_instance().to_ptr();
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	// Request-scoped objects: the arena is reclaimed after every batch of objects
+	template<class Class>
+	bench::body_t create_instance_in(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			std::pmr::monotonic_buffer_resource arena;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				{
+					auto p = Class::create_instance_in(arena).to_ptr();
+					bench::do_not_optimize(p);
+				}
+				// Every object must be destroyed before the memory resource is released
+				if (i % 1024 == 1023)
+					arena.release();
+			}
+		};
+	}
+
+	template<const GUID &clsid>
+	bench::body_t create_object(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				bcom::ptr<IBench0> p;
+				belt::com::create_object(clsid, p);
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	// The cached instance is kept alive for the whole run, so that requests find it
+	template<const GUID &clsid>
+	bench::body_t create_object_alive(unsigned)
+	{
+		bcom::ptr<IBench0> alive;
+		belt::com::create_object(clsid, alive);
+		return [alive](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				bcom::ptr<IBench0> p;
+				belt::com::create_object(clsid, p);
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	bench::body_t make_shared(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto p = std::make_shared<int>(0);
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	bench::registrar r1{ "creation/create_instance/small", create_instance<bench_small>, 2'000'000 };
+	bench::registrar r2{ "creation/create_instance/small/pooled", create_instance<bench_small_pooled>, 2'000'000 };
+	bench::registrar r3{ "creation/create_instance/large", create_instance<bench_large>, 2'000'000 };
+	bench::registrar r4{ "creation/create_instance_in/small", create_instance_in<bench_small>, 2'000'000 };
+	bench::registrar r5{ "creation/create_object/small", create_object<CLSID_BenchSmall>, 2'000'000 };
+	bench::registrar r6{ "creation/create_object/large", create_object<CLSID_BenchLarge>, 2'000'000 };
+	bench::registrar r7{ "creation/create_object/singleton", create_object<CLSID_BenchSingleton>, 2'000'000 };
+	bench::registrar r8{ "creation/create_object/single_cached_instance", create_object_alive<CLSID_BenchCached>, 2'000'000 };
+	bench::registrar r9{ "creation/baseline/make_shared", make_shared, 2'000'000 };
+}
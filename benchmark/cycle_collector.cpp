@@ -0,0 +1,136 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <mutex>
+
+// Collection of garbage cycles, compared with breaking the same cycles by hand. Creation of tracked objects is compared with
+// untracked ones
+
+namespace
+{
+	BELT_DEFINE_INTERFACE(IBenchLink, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A10}")
+	{
+		virtual void link(const bcom::ptr<IBenchLink> &next) noexcept = 0;
+	};
+
+	template<class Derived>
+	class BELT_NOVTABLE bench_link_base :
+		public belt::com::object<Derived, IBenchLink>
+	{
+	protected:
+		std::mutex lock;
+		bcom::ptr<IBenchLink> next;
+
+	public:
+		virtual void link(const bcom::ptr<IBenchLink> &p) noexcept override
+		{
+			std::scoped_lock l{ lock };
+			next = p;
+		}
+	};
+
+	class BELT_NOVTABLE bench_link : public bench_link_base<bench_link>
+	{
+	};
+
+	class BELT_NOVTABLE bench_link_tracked :
+		public bench_link_base<bench_link_tracked>,
+		public belt::com::collects_cycles
+	{
+	public:
+		virtual void link(const bcom::ptr<IBenchLink> &p) noexcept override
+		{
+			std::scoped_lock l{ lock };
+			next = p;
+			members_changed();
+		}
+
+		void traverse(belt::com::cycle_visitor &visitor)
+		{
+			std::scoped_lock l{ lock };
+			visitor(next);
+		}
+	};
+
+	// Number of cycles created between collections
+	constexpr size_t batch = 1000;
+
+	template<class T>
+	bench::body_t create(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto p = T::create_instance().template to_ptr<IBenchLink>();
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	// Each iteration creates a cycle of two objects and drops it, the collector destroys a batch of them at a time
+	bench::body_t collect_cycles(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto a = bench_link_tracked::create_instance().to_ptr<IBenchLink>();
+				auto b = bench_link_tracked::create_instance().to_ptr<IBenchLink>();
+				a->link(b);
+				b->link(a);
+				if (i % batch == batch - 1)
+				{
+					a = nullptr;
+					b = nullptr;
+					auto result = belt::com::collect_cycles();
+					bench::do_not_optimize(result);
+				}
+			}
+			belt::com::collect_cycles();
+		};
+	}
+
+	// The same cycles broken by the owner before it drops them
+	bench::body_t break_cycles(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto a = bench_link::create_instance().to_ptr<IBenchLink>();
+				auto b = bench_link::create_instance().to_ptr<IBenchLink>();
+				a->link(b);
+				b->link(a);
+				a->link(nullptr);
+			}
+		};
+	}
+
+	// Each iteration is a collection that finds no garbage among a batch of alive objects
+	bench::body_t scan_alive(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			std::vector<bcom::ptr<IBenchLink>> alive;
+			for (size_t i = 0; i < batch; ++i)
+			{
+				alive.push_back(bench_link_tracked::create_instance().to_ptr<IBenchLink>());
+				if (i)
+					alive[i - 1]->link(alive[i]);
+			}
+
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto result = belt::com::collect_cycles();
+				bench::do_not_optimize(result);
+			}
+		};
+	}
+
+	bench::registrar r1{ "cycle_collector/create/tracked", create<bench_link_tracked>, 2'000'000 };
+	bench::registrar r2{ "cycle_collector/create/untracked", create<bench_link>, 2'000'000 };
+	bench::registrar r3{ "cycle_collector/collect/cycle", collect_cycles, 1'000'000, false };
+	bench::registrar r4{ "cycle_collector/collect/alive_1000", scan_alive, 2'000, false };
+	bench::registrar r5{ "cycle_collector/baseline/break_cycle", break_cycles, 1'000'000, false };
+}
@@ -0,0 +1,116 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Releasing objects that own a graph of child objects, with the teardown deferred to drain calls or to a reclaimer thread,
+// compared with destroying them on the releasing thread
+
+namespace
+{
+	constexpr size_t children = 16;
+
+	template<class Derived>
+	class BELT_NOVTABLE bench_graph_base :
+		public belt::com::object<Derived, IBench0>
+	{
+		std::vector<bcom::ptr<IBench0>> owned;
+
+	public:
+		bench_graph_base()
+		{
+			owned.reserve(children);
+			for (size_t i = 0; i < children; ++i)
+				owned.push_back(bench_small::create_instance().to_ptr());
+		}
+
+		BENCH_IMPLEMENT(0)
+	};
+
+	class BELT_NOVTABLE bench_graph : public bench_graph_base<bench_graph>
+	{
+	};
+
+	class BELT_NOVTABLE bench_graph_deferred :
+		public bench_graph_base<bench_graph_deferred>,
+		public belt::com::deferred_destruction
+	{
+	};
+
+	// Number of objects released between drain calls
+	constexpr size_t batch = 1000;
+
+	template<class T>
+	void create_and_release(size_t iterations)
+	{
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			auto p = T::create_instance().to_ptr();
+			bench::do_not_optimize(p);
+		}
+	}
+
+	bench::body_t release_drain(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; i += batch)
+			{
+				create_and_release<bench_graph_deferred>(std::min(batch, iterations - i));
+				belt::com::drain_deferred();
+			}
+		};
+	}
+
+	bench::body_t release_reclaimer_thread(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			belt::com::reclaimer_thread reclaimer;
+			create_and_release<bench_graph_deferred>(iterations);
+		};
+	}
+
+	bench::body_t release_inline(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			create_and_release<bench_graph>(iterations);
+		};
+	}
+
+	// Releases objects created by the setup, so that only the work done by the releasing thread is measured. Deferred objects
+	// are destroyed when the body is destroyed
+	struct drain_on_exit
+	{
+		~drain_on_exit()
+		{
+			belt::com::drain_deferred();
+		}
+	};
+
+	constexpr size_t release_count = 50'000;
+
+	template<class T>
+	bench::body_t release_only(unsigned)
+	{
+		auto objects = std::make_shared<std::vector<bcom::ptr<IBench0>>>();
+		objects->reserve(release_count);
+		for (size_t i = 0; i < release_count; ++i)
+			objects->push_back(T::create_instance().to_ptr());
+
+		return [objects, drain = std::make_shared<drain_on_exit>()](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < std::min(iterations, release_count); ++i)
+				(*objects)[i] = nullptr;
+		};
+	}
+
+	bench::registrar r1{ "deferred_destruction/release/drain", release_drain, 200'000, false };
+	bench::registrar r2{ "deferred_destruction/release/reclaimer_thread", release_reclaimer_thread, 200'000, false };
+	bench::registrar r3{ "deferred_destruction/release_only/deferred", release_only<bench_graph_deferred>, release_count, false };
+	bench::registrar r4{ "deferred_destruction/baseline/release_inline", release_inline, 200'000, false };
+	bench::registrar r5{ "deferred_destruction/baseline/release_only/inline", release_only<bench_graph>, release_count, false };
+}
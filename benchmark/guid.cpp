@@ -0,0 +1,227 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <version>
+#if defined(__cpp_lib_format)
+#include <format>
+#endif
+
+// Runtime GUID parsing, formatting and generation, compared with the scalar code used at compile time, with sscanf and snprintf,
+// and with random_device, which reads the operating system's random number generator like CoCreateGuid does
+
+namespace
+{
+	// Operations cycle through this many GUIDs
+	constexpr size_t guid_count = 1024;
+
+	std::vector<GUID> random_guids()
+	{
+		std::mt19937_64 engine{ 2017 };
+		std::vector<GUID> result(guid_count);
+		for (auto &guid : result)
+		{
+			const uint64_t parts[2]{ engine(), engine() };
+			std::memcpy(&guid, parts, sizeof(guid));
+		}
+		return result;
+	}
+
+	std::vector<std::string> guid_strings()
+	{
+		std::vector<std::string> result;
+		for (const auto &g : random_guids())
+		{
+			char buffer[39];
+			std::snprintf(buffer, sizeof(buffer), "{%08" PRIX32 "-%04" PRIX16 "-%04" PRIX16 "-%02X%02X-%02X%02X%02X%02X%02X%02X}", g.Data1, g.Data2, g.Data3,
+				g.Data4[0], g.Data4[1], g.Data4[2], g.Data4[3], g.Data4[4], g.Data4[5], g.Data4[6], g.Data4[7]);
+			result.emplace_back(buffer);
+		}
+		return result;
+	}
+
+	template<class Parse>
+	bench::setup_t parse(Parse parse_one)
+	{
+		return [=](unsigned) -> bench::body_t
+		{
+			return [strings = guid_strings(), parse_one](unsigned, size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					auto guid = parse_one(strings[i % guid_count]);
+					bench::do_not_optimize(guid);
+				}
+			};
+		};
+	}
+
+	std::optional<GUID> parse_simd(const std::string &str) noexcept
+	{
+		return belt::com::parse_guid(str);
+	}
+
+	std::optional<GUID> parse_scalar(const std::string &str) noexcept
+	{
+		return belt::com::details::parse_guid_scalar(str.data() + 1);
+	}
+
+	std::optional<GUID> parse_sscanf(const std::string &str) noexcept
+	{
+		GUID g;
+		unsigned data4[8];
+		if (11 != std::sscanf(str.c_str(), "{%8" SCNx32 "-%4" SCNx16 "-%4" SCNx16 "-%2x%2x-%2x%2x%2x%2x%2x%2x}", &g.Data1, &g.Data2, &g.Data3,
+			&data4[0], &data4[1], &data4[2], &data4[3], &data4[4], &data4[5], &data4[6], &data4[7]))
+			return std::nullopt;
+		for (size_t i = 0; i < 8; ++i)
+			g.Data4[i] = static_cast<uint8_t>(data4[i]);
+		return g;
+	}
+
+	// Each iteration parses one string of a column
+	bench::body_t parse_batch(unsigned)
+	{
+		return [strings = guid_strings()](unsigned, size_t iterations)
+		{
+			const std::vector<std::string_view> column(strings.begin(), strings.end());
+			std::vector<GUID> result(guid_count);
+			for (size_t i = 0; i < iterations; i += guid_count)
+			{
+				auto parsed = belt::com::parse_guids(column, result);
+				bench::do_not_optimize(parsed);
+			}
+		};
+	}
+
+	template<class Format>
+	bench::setup_t format(Format format_one)
+	{
+		return [=](unsigned) -> bench::body_t
+		{
+			return [guids = random_guids(), format_one](unsigned, size_t iterations)
+			{
+				char buffer[39];
+				for (size_t i = 0; i < iterations; ++i)
+				{
+					auto last = format_one(buffer, guids[i % guid_count]);
+					bench::do_not_optimize(last);
+					bench::do_not_optimize(buffer);
+				}
+			};
+		};
+	}
+
+	char *format_simd(char *buffer, const GUID &guid) noexcept
+	{
+		return belt::com::to_chars(buffer, guid);
+	}
+
+	char *format_simd_unbraced(char *buffer, const GUID &guid) noexcept
+	{
+		return belt::com::to_chars(buffer, guid, false);
+	}
+
+	char *format_scalar(char *buffer, const GUID &guid) noexcept
+	{
+		buffer[0] = '{';
+		belt::com::details::format_guid_scalar(guid, buffer + 1);
+		buffer[37] = '}';
+		return buffer + 38;
+	}
+
+#if defined(__cpp_lib_format)
+	char *format_std_format(char *buffer, const GUID &guid)
+	{
+		return std::format_to(buffer, "{}", guid);
+	}
+#endif
+
+	char *format_snprintf(char *buffer, const GUID &g) noexcept
+	{
+		return buffer + std::snprintf(buffer, 39, "{%08" PRIX32 "-%04" PRIX16 "-%04" PRIX16 "-%02X%02X-%02X%02X%02X%02X%02X%02X}", g.Data1, g.Data2, g.Data3,
+			g.Data4[0], g.Data4[1], g.Data4[2], g.Data4[3], g.Data4[4], g.Data4[5], g.Data4[6], g.Data4[7]);
+	}
+
+	// Writes to a stream that is rewound after each GUID
+	bench::body_t format_ostream(unsigned)
+	{
+		return [guids = random_guids()](unsigned, size_t iterations)
+		{
+			std::ostringstream stream;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				stream.seekp(0);
+				stream << guids[i % guid_count];
+				bench::do_not_optimize(stream);
+			}
+		};
+	}
+
+	template<GUID (*Generate)()>
+	bench::body_t generate(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto guid = Generate();
+				bench::do_not_optimize(guid);
+			}
+		};
+	}
+
+	// Each iteration fills one element of a buffer
+	template<void (*Generate)(std::span<GUID>)>
+	bench::body_t generate_batch(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			std::vector<GUID> buffer(guid_count);
+			for (size_t i = 0; i < iterations; i += guid_count)
+			{
+				Generate(buffer);
+				bench::do_not_optimize(buffer);
+			}
+		};
+	}
+
+	bench::body_t generate_random_device(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			std::random_device source;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				const uint32_t parts[4]{ source(), source(), source(), source() };
+				GUID guid;
+				std::memcpy(&guid, parts, sizeof(guid));
+				guid.Data3 = static_cast<uint16_t>((guid.Data3 & 0x0fff) | 0x4000);
+				guid.Data4[0] = static_cast<uint8_t>((guid.Data4[0] & 0x3f) | 0x80);
+				bench::do_not_optimize(guid);
+			}
+		};
+	}
+
+	bench::registrar r1{ "guid/parse/simd", parse(parse_simd), 20'000'000 };
+	bench::registrar r2{ "guid/parse/scalar", parse(parse_scalar), 20'000'000 };
+	bench::registrar r3{ "guid/parse/batch", parse_batch, 20'000'000 };
+	bench::registrar r4{ "guid/baseline/parse/sscanf", parse(parse_sscanf), 2'000'000 };
+	bench::registrar r5{ "guid/format/to_chars", format(format_simd), 20'000'000 };
+	bench::registrar r6{ "guid/format/to_chars/unbraced", format(format_simd_unbraced), 20'000'000 };
+	bench::registrar r7{ "guid/format/scalar", format(format_scalar), 20'000'000 };
+	bench::registrar r8{ "guid/format/ostream", format_ostream, 5'000'000 };
+#if defined(__cpp_lib_format)
+	bench::registrar r9{ "guid/format/std_format", format(format_std_format), 20'000'000 };
+#endif
+	bench::registrar r10{ "guid/baseline/format/snprintf", format(format_snprintf), 2'000'000 };
+	bench::registrar r11{ "guid/generate/v4", generate<belt::com::generate_guid>, 50'000'000 };
+	bench::registrar r12{ "guid/generate/v7", generate<belt::com::generate_guid_v7>, 20'000'000 };
+	bench::registrar r13{ "guid/generate/batch/v4", generate_batch<belt::com::generate_guids>, 50'000'000 };
+	bench::registrar r14{ "guid/generate/batch/v7", generate_batch<belt::com::generate_guids_v7>, 50'000'000 };
+	bench::registrar r15{ "guid/baseline/generate/random_device", generate_random_device, 1'000'000 };
+}
@@ -0,0 +1,101 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <moderncom/guid_map.h>
+
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// GUID hashing and lookups in guid_map, compared with standard containers keyed by GUID
+
+namespace
+{
+	// Maps hold this many GUIDs, lookups cycle through as many
+	constexpr size_t key_count = 1024;
+
+	// Half of the keys are random, the other half are allocated sequentially, like the CLSIDs of a type library
+	std::vector<GUID> make_keys(bool miss)
+	{
+		std::mt19937_64 engine{ miss ? 2018u : 2017u };
+		std::vector<GUID> result(key_count);
+		for (size_t i = 0; i < key_count; ++i)
+		{
+			if (i % 2)
+				result[i] = { 0x5A6F3C1E, 0x0B3D, 0x4E3A, { 0x9B, 0x8E, 0x1F, 0x2D, 0x3C, static_cast<uint8_t>(miss ? 0x61 : 0x60), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(i) } };
+			else
+			{
+				const uint64_t parts[2]{ engine(), engine() };
+				std::memcpy(&result[i], parts, sizeof(GUID));
+			}
+		}
+		return result;
+	}
+
+	template<class Map>
+	Map make_map()
+	{
+		Map map;
+		size_t n{};
+		for (const auto &key : make_keys(false))
+			map[key] = n++;
+		return map;
+	}
+
+	bench::body_t hash(unsigned)
+	{
+		return [keys = make_keys(false)](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto h = belt::com::hash_guid(keys[i % key_count]);
+				bench::do_not_optimize(h);
+			}
+		};
+	}
+
+	template<class Map, bool miss>
+	bench::body_t find(unsigned)
+	{
+		return [map = make_map<Map>(), keys = make_keys(miss)](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto found = map.find(keys[i % key_count]) != map.end();
+				bench::do_not_optimize(found);
+			}
+		};
+	}
+
+	// Each iteration inserts one key into a map that is rebuilt every key_count iterations
+	template<class Map>
+	bench::body_t insert(unsigned)
+	{
+		return [keys = make_keys(false)](unsigned, size_t iterations)
+		{
+			Map map;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				if (i % key_count == 0)
+					map = Map{};
+				map[keys[i % key_count]] = i;
+			}
+			bench::do_not_optimize(map);
+		};
+	}
+
+	using guid_map_t = bcom::guid_map<size_t>;
+	using unordered_map_t = std::unordered_map<GUID, size_t>;
+	using map_t = std::map<GUID, size_t>;
+
+	bench::registrar r1{ "guid_map/hash", hash, 50'000'000 };
+	bench::registrar r2{ "guid_map/find/hit", find<guid_map_t, false>, 20'000'000 };
+	bench::registrar r3{ "guid_map/find/miss", find<guid_map_t, true>, 20'000'000 };
+	bench::registrar r4{ "guid_map/insert", insert<guid_map_t>, 5'000'000 };
+	bench::registrar r5{ "guid_map/baseline/unordered_map/find/hit", find<unordered_map_t, false>, 20'000'000 };
+	bench::registrar r6{ "guid_map/baseline/unordered_map/find/miss", find<unordered_map_t, true>, 20'000'000 };
+	bench::registrar r7{ "guid_map/baseline/unordered_map/insert", insert<unordered_map_t>, 5'000'000 };
+	bench::registrar r8{ "guid_map/baseline/map/find/hit", find<map_t, false>, 5'000'000 };
+	bench::registrar r9{ "guid_map/baseline/map/find/miss", find<map_t, true>, 5'000'000 };
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Minimal self-contained benchmark harness.
+// A benchmark is a setup function that is invoked once per run with a number of threads. It returns a body that is then
+// invoked concurrently on each thread with the thread index and the number of iterations to perform.
+
+namespace bench
+{
+	using body_t = std::function<void(unsigned index, size_t iterations)>;
+	using setup_t = std::function<body_t(unsigned threads)>;
+
+	struct benchmark
+	{
+		std::string name;
+		setup_t setup;
+		size_t iterations;
+		bool multithreaded;
+	};
+
+	inline std::vector<benchmark> &registry()
+	{
+		static std::vector<benchmark> benchmarks;
+		return benchmarks;
+	}
+
+	struct registrar
+	{
+		registrar(const char *name, setup_t setup, size_t iterations, bool multithreaded = true)
+		{
+			registry().push_back({ name, std::move(setup), iterations, multithreaded });
+		}
+	};
+
+	// Every thread works with the same object, created once per run
+	template<class Factory, class Operation>
+	inline setup_t shared_object(Factory make, Operation op)
+	{
+		return [=](unsigned) -> body_t
+		{
+			auto object = make();
+			return [object, op](unsigned, size_t iterations)
+			{
+				for (size_t i = 0; i < iterations; ++i)
+					op(object);
+			};
+		};
+	}
+
+	// Every thread works with its own object, created on that thread
+	template<class Factory, class Operation>
+	inline setup_t private_object(Factory make, Operation op)
+	{
+		return [=](unsigned) -> body_t
+		{
+			return [make, op](unsigned, size_t iterations)
+			{
+				auto object = make();
+				for (size_t i = 0; i < iterations; ++i)
+					op(object);
+			};
+		};
+	}
+
+	// Prevent the optimizer from removing a computation whose result is not otherwise used
+	template<class T>
+	inline void do_not_optimize(T &&value) noexcept
+	{
+#if defined(_MSC_VER)
+		static_cast<void>(*static_cast<const volatile char *>(static_cast<const void *>(&value)));
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+
+	struct result
+	{
+		double ns_per_op;
+		double mops;
+	};
+
+	inline result run(const benchmark &b, unsigned threads, size_t iterations)
+	{
+		auto body = b.setup(threads);
+		std::atomic<unsigned> ready{};
+		std::atomic<bool> go{};
+		std::vector<double> elapsed(threads);
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+
+		for (unsigned index = 0; index < threads; ++index)
+		{
+			workers.emplace_back([&, index]
+				{
+					ready.fetch_add(1, std::memory_order_acq_rel);
+					while (!go.load(std::memory_order_acquire))
+						std::this_thread::yield();
+
+					auto start = std::chrono::steady_clock::now();
+					body(index, iterations);
+					elapsed[index] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+				});
+		}
+
+		while (ready.load(std::memory_order_acquire) != threads)
+			std::this_thread::yield();
+		go.store(true, std::memory_order_release);
+
+		for (auto &worker : workers)
+			worker.join();
+
+		// Per-thread latency is averaged over threads, throughput is measured against the slowest thread
+		double total{}, slowest{};
+		for (auto e : elapsed)
+		{
+			total += e;
+			slowest = std::max(slowest, e);
+		}
+
+		return { total / threads / iterations, static_cast<double>(iterations) * threads / slowest * 1000.0 };
+	}
+
+	struct options
+	{
+		std::vector<std::string> filters;
+		unsigned max_threads{ std::max(1u, std::thread::hardware_concurrency()) };
+		size_t divisor{ 1 };
+	};
+
+	inline bool matches(const options &opts, const std::string &name)
+	{
+		if (opts.filters.empty())
+			return true;
+		return std::any_of(opts.filters.begin(), opts.filters.end(), [&](const std::string &filter)
+			{
+				return name.find(filter) != std::string::npos;
+			});
+	}
+
+	// 1, 2, 4, ... up to and including max_threads
+	inline std::vector<unsigned> thread_counts(unsigned max_threads)
+	{
+		std::vector<unsigned> counts;
+		for (unsigned threads = 1; threads < max_threads; threads *= 2)
+			counts.push_back(threads);
+		counts.push_back(max_threads);
+		return counts;
+	}
+
+	inline void run_all(const options &opts)
+	{
+		std::printf("%-48s %7s %12s %12s\n", "benchmark", "threads", "ns/op", "Mops/s");
+		for (const auto &b : registry())
+		{
+			if (!matches(opts, b.name))
+				continue;
+
+			auto iterations = std::max<size_t>(1, b.iterations / opts.divisor);
+			for (auto threads : thread_counts(b.multithreaded ? opts.max_threads : 1u))
+			{
+				auto r = run(b, threads, iterations);
+				std::printf("%-48s %7u %12.2f %12.2f\n", b.name.c_str(), threads, r.ns_per_op, r.mops);
+				std::fflush(stdout);
+			}
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#include "harness.h"
+
+#include <cstdlib>
+
+// Usage: moderncom_benchmark [--list] [--quick] [--threads N] [filter...]
+//	--list		print names of registered benchmarks
+//	--quick		run 100 times fewer iterations (smoke test)
+//	--threads N	run multithreaded benchmarks with 1, 2, 4, ... N threads (defaults to the number of hardware threads)
+//	filter		run only benchmarks whose name contains one of the given substrings
+
+int main(int argc, char *argv[])
+{
+	bench::options opts;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg{ argv[i] };
+		if (arg == "--list")
+		{
+			for (const auto &b : bench::registry())
+				std::printf("%s\n", b.name.c_str());
+			return 0;
+		}
+		else if (arg == "--quick")
+			opts.divisor = 100;
+		else if (arg == "--threads" && i + 1 < argc)
+			opts.max_threads = std::max(1, std::atoi(argv[++i]));
+		else
+			opts.filters.push_back(std::move(arg));
+	}
+
+	bench::run_all(opts);
+}
@@ -0,0 +1,71 @@
+#include "harness.h"
+#include "objects.h"
+
+// Using three interfaces of an object held by a multi_ptr, compared with converting a com_ptr with as<>() every time
+
+namespace
+{
+	using multi_t = bcom::multi_ptr<IBench0, IBench5, IBench10, IBench15>;
+
+	multi_t make_multi()
+	{
+		return { bench_large::create_instance().to_ptr() };
+	}
+
+	bcom::ptr<IBench0> make_ptr()
+	{
+		return bench_large::create_instance().to_ptr();
+	}
+
+	void use_multi(const multi_t &p) noexcept
+	{
+		auto sum = p.get<IBench5>()->value5() + p.get<IBench10>()->value10() + p.get<IBench15>()->value15();
+		bench::do_not_optimize(sum);
+	}
+
+	void use_as(const bcom::ptr<IBench0> &p) noexcept
+	{
+		auto sum = p.as<IBench5>()->value5() + p.as<IBench10>()->value10() + p.as<IBench15>()->value15();
+		bench::do_not_optimize(sum);
+	}
+
+	// Each iteration creates a multi_ptr from a com_ptr and resolves all interfaces
+	void resolve(const bcom::ptr<IBench0> &p) noexcept
+	{
+		multi_t multi{ p };
+		use_multi(multi);
+	}
+
+	// The object is created, interfaces are cast statically
+	bench::body_t create_resolved(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto p = bench_large::create_instance().to_multi_ptr<IBench0, IBench5, IBench10, IBench15>();
+				use_multi(p);
+			}
+		};
+	}
+
+	bench::body_t create_queried(unsigned)
+	{
+		return [](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				multi_t p{ bench_large::create_instance().to_ptr() };
+				use_multi(p);
+			}
+		};
+	}
+
+	bench::registrar r1{ "multi_ptr/use/private", bench::private_object(make_multi, use_multi), 20'000'000 };
+	bench::registrar r2{ "multi_ptr/resolve/shared", bench::shared_object(make_ptr, resolve), 5'000'000 };
+	bench::registrar r3{ "multi_ptr/resolve/private", bench::private_object(make_ptr, resolve), 5'000'000 };
+	bench::registrar r4{ "multi_ptr/create/to_multi_ptr", create_resolved, 2'000'000 };
+	bench::registrar r5{ "multi_ptr/create/query", create_queried, 2'000'000 };
+	bench::registrar r6{ "multi_ptr/baseline/as/shared", bench::shared_object(make_ptr, use_as), 5'000'000 };
+	bench::registrar r7{ "multi_ptr/baseline/as/private", bench::private_object(make_ptr, use_as), 5'000'000 };
+}
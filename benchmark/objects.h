@@ -0,0 +1,131 @@
+#pragma once
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define BELT_COM_NO_LEAK_DETECTION
+#include <moderncom/interfaces.h>
+
+// Interfaces and classes shared by benchmarks
+
+#define BENCH_INTERFACE(n, id) \
+BELT_DEFINE_INTERFACE(IBench##n, id) \
+{ \
+	virtual int value##n() const noexcept = 0; \
+} \
+// end of macro
+
+BENCH_INTERFACE(0, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A00}");
+BENCH_INTERFACE(1, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A01}");
+BENCH_INTERFACE(2, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A02}");
+BENCH_INTERFACE(3, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A03}");
+BENCH_INTERFACE(4, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A04}");
+BENCH_INTERFACE(5, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A05}");
+BENCH_INTERFACE(6, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A06}");
+BENCH_INTERFACE(7, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A07}");
+BENCH_INTERFACE(8, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A08}");
+BENCH_INTERFACE(9, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A09}");
+BENCH_INTERFACE(10, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A0A}");
+BENCH_INTERFACE(11, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A0B}");
+BENCH_INTERFACE(12, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A0C}");
+BENCH_INTERFACE(13, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A0D}");
+BENCH_INTERFACE(14, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A0E}");
+BENCH_INTERFACE(15, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5A0F}");
+
+// Never implemented, used to measure QueryInterface misses
+BENCH_INTERFACE(Missing, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5AFF}");
+
+BELT_DEFINE_CLASS(CLSID_BenchSmall, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5B00}");
+BELT_DEFINE_CLASS(CLSID_BenchLarge, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5B01}");
+BELT_DEFINE_CLASS(CLSID_BenchSingleton, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5B02}");
+BELT_DEFINE_CLASS(CLSID_BenchCached, "{5A6F3C1E-0B3D-4E3A-9B8E-1F2D3C4B5B03}");
+
+#define BENCH_IMPLEMENT(n) \
+	virtual int value##n() const noexcept override \
+	{ \
+		return n; \
+	} \
+// end of macro
+
+// Object with a single interface
+class BELT_NOVTABLE bench_small :
+	public belt::com::object<bench_small, IBench0>
+{
+	BENCH_IMPLEMENT(0)
+};
+
+// The same object with non-default reference count policies
+class BELT_NOVTABLE bench_small_single_threaded :
+	public belt::com::object<bench_small_single_threaded, IBench0>,
+	public belt::com::single_threaded_ref_count
+{
+	BENCH_IMPLEMENT(0)
+};
+
+class BELT_NOVTABLE bench_small_wide :
+	public belt::com::object<bench_small_wide, IBench0>,
+	public belt::com::wide_ref_count
+{
+	BENCH_IMPLEMENT(0)
+};
+
+class BELT_NOVTABLE bench_small_biased :
+	public belt::com::object<bench_small_biased, IBench0>,
+	public belt::com::biased_ref_count
+{
+	BENCH_IMPLEMENT(0)
+};
+
+class BELT_NOVTABLE bench_small_weak :
+	public belt::com::object<bench_small_weak, IBench0>,
+	public belt::com::supports_weak_references
+{
+	BENCH_IMPLEMENT(0)
+};
+
+class BELT_NOVTABLE bench_small_pooled :
+	public belt::com::object<bench_small_pooled, IBench0>,
+	public belt::com::pooled
+{
+	BENCH_IMPLEMENT(0)
+};
+
+// Objects created by create_object as a single instance
+class BELT_NOVTABLE bench_singleton :
+	public belt::com::object<bench_singleton, IBench0>,
+	public belt::com::singleton_factory
+{
+	BENCH_IMPLEMENT(0)
+};
+
+class BELT_NOVTABLE bench_cached :
+	public belt::com::object<bench_cached, IBench0>,
+	public belt::com::single_cached_instance
+{
+	BENCH_IMPLEMENT(0)
+};
+
+// Object with 16 interfaces, used to measure QueryInterface at various positions in the interface list
+class BELT_NOVTABLE bench_large :
+	public belt::com::object<bench_large,
+		IBench0, IBench1, IBench2, IBench3, IBench4, IBench5, IBench6, IBench7,
+		IBench8, IBench9, IBench10, IBench11, IBench12, IBench13, IBench14, IBench15>
+{
+	BENCH_IMPLEMENT(0)
+	BENCH_IMPLEMENT(1)
+	BENCH_IMPLEMENT(2)
+	BENCH_IMPLEMENT(3)
+	BENCH_IMPLEMENT(4)
+	BENCH_IMPLEMENT(5)
+	BENCH_IMPLEMENT(6)
+	BENCH_IMPLEMENT(7)
+	BENCH_IMPLEMENT(8)
+	BENCH_IMPLEMENT(9)
+	BENCH_IMPLEMENT(10)
+	BENCH_IMPLEMENT(11)
+	BENCH_IMPLEMENT(12)
+	BENCH_IMPLEMENT(13)
+	BENCH_IMPLEMENT(14)
+	BENCH_IMPLEMENT(15)
+};
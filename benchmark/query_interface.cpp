@@ -0,0 +1,31 @@
+#include "harness.h"
+#include "objects.h"
+
+// object<>::QueryInterface hits at various positions in the interface list and misses
+
+namespace
+{
+	auto make_large()
+	{
+		return bench_large::create_instance().to_ptr();
+	}
+
+	template<class Interface>
+	void query(const bcom::ptr<IBench0> &p) noexcept
+	{
+		void *result{};
+		if (SUCCEEDED(p->QueryInterface(belt::com::get_interface_guid<Interface>(), &result)))
+			static_cast<IUnknown *>(result)->Release();
+		bench::do_not_optimize(result);
+	}
+
+	bench::registrar r1{ "query_interface/hit/IUnknown/shared", bench::shared_object(make_large, query<IUnknown>), 10'000'000 };
+	bench::registrar r2{ "query_interface/hit/first/shared", bench::shared_object(make_large, query<IBench0>), 10'000'000 };
+	bench::registrar r3{ "query_interface/hit/middle/shared", bench::shared_object(make_large, query<IBench7>), 10'000'000 };
+	bench::registrar r4{ "query_interface/hit/last/shared", bench::shared_object(make_large, query<IBench15>), 10'000'000 };
+	bench::registrar r5{ "query_interface/hit/first/private", bench::private_object(make_large, query<IBench0>), 10'000'000 };
+	bench::registrar r6{ "query_interface/hit/middle/private", bench::private_object(make_large, query<IBench7>), 10'000'000 };
+	bench::registrar r7{ "query_interface/hit/last/private", bench::private_object(make_large, query<IBench15>), 10'000'000 };
+	bench::registrar r8{ "query_interface/miss/shared", bench::shared_object(make_large, query<IBenchMissing>), 10'000'000 };
+	bench::registrar r9{ "query_interface/miss/private", bench::private_object(make_large, query<IBenchMissing>), 10'000'000 };
+}
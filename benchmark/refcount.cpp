@@ -0,0 +1,73 @@
+#include "harness.h"
+#include "objects.h"
+#include "baselines.h"
+
+#include <memory>
+
+// value<T>::AddRef/Release compared with std::shared_ptr and intrusive_ptr-style counters
+
+namespace
+{
+	auto make_small()
+	{
+		return bench_small::create_instance().to_ptr();
+	}
+
+	auto make_small_single_threaded()
+	{
+		return bench_small_single_threaded::create_instance().to_ptr();
+	}
+
+	auto make_small_wide()
+	{
+		return bench_small_wide::create_instance().to_ptr();
+	}
+
+	auto make_small_biased()
+	{
+		return bench_small_biased::create_instance().to_ptr();
+	}
+
+	void addref_release(const bcom::ptr<IBench0> &p) noexcept
+	{
+		p->AddRef();
+		p->Release();
+	}
+
+	auto make_shared_ptr()
+	{
+		return std::make_shared<int>(0);
+	}
+
+	void copy_shared_ptr(const std::shared_ptr<int> &p) noexcept
+	{
+		auto copy = p;
+		bench::do_not_optimize(copy);
+	}
+
+	auto make_intrusive()
+	{
+		return bench::intrusive_ptr<bench::intrusive_counted>{ new bench::intrusive_counted };
+	}
+
+	void copy_intrusive(const bench::intrusive_ptr<bench::intrusive_counted> &p) noexcept
+	{
+		auto copy = p;
+		bench::do_not_optimize(copy);
+	}
+
+	bench::registrar r1{ "refcount/value/shared", bench::shared_object(make_small, addref_release), 20'000'000 };
+	bench::registrar r2{ "refcount/value/private", bench::private_object(make_small, addref_release), 20'000'000 };
+	// Single-threaded objects may only be used by their creating thread
+	bench::registrar r3{ "refcount/value/single_threaded/private", bench::private_object(make_small_single_threaded, addref_release), 20'000'000 };
+	bench::registrar r4{ "refcount/value/wide/shared", bench::shared_object(make_small_wide, addref_release), 20'000'000 };
+	bench::registrar r5{ "refcount/value/wide/private", bench::private_object(make_small_wide, addref_release), 20'000'000 };
+	// Biased objects are owned by the thread that takes the first reference: the setup thread for shared objects, so workers
+	// measure the atomic (non-owner) path, and the worker itself for private objects
+	bench::registrar r6{ "refcount/value/biased/shared", bench::shared_object(make_small_biased, addref_release), 20'000'000 };
+	bench::registrar r7{ "refcount/value/biased/private", bench::private_object(make_small_biased, addref_release), 20'000'000 };
+	bench::registrar r8{ "refcount/baseline/shared_ptr/shared", bench::shared_object(make_shared_ptr, copy_shared_ptr), 20'000'000 };
+	bench::registrar r9{ "refcount/baseline/shared_ptr/private", bench::private_object(make_shared_ptr, copy_shared_ptr), 20'000'000 };
+	bench::registrar r10{ "refcount/baseline/intrusive_ptr/shared", bench::shared_object(make_intrusive, copy_intrusive), 20'000'000 };
+	bench::registrar r11{ "refcount/baseline/intrusive_ptr/private", bench::private_object(make_intrusive, copy_intrusive), 20'000'000 };
+}
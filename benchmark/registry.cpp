@@ -0,0 +1,101 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <vector>
+
+// CLSID lookup in the class registry of a module with a thousand registered classes, compared with scanning the
+// registration section
+
+namespace
+{
+	constexpr GUID registry_clsid(uint32_t n) noexcept
+	{
+		return { 0x5A6F3C1E, 0x0B3D, 0x4E3A, { 0x9B, 0x8E, 0x1F, 0x2D, 0x3C, static_cast<uint8_t>(0x60 + (n >> 16)), static_cast<uint8_t>(n >> 8), static_cast<uint8_t>(n) } };
+	}
+}
+
+// Registers classes with CLSIDs 1000 to 1999
+#define REGISTRY_ENTRY(n) BELT_OBJ_ENTRY_AUTO2_NAMED(registry_clsid(1##n), bench_small, _registry##n)
+#define REGISTRY_ENTRY10(n) REGISTRY_ENTRY(n##0) REGISTRY_ENTRY(n##1) REGISTRY_ENTRY(n##2) REGISTRY_ENTRY(n##3) REGISTRY_ENTRY(n##4) REGISTRY_ENTRY(n##5) REGISTRY_ENTRY(n##6) REGISTRY_ENTRY(n##7) REGISTRY_ENTRY(n##8) REGISTRY_ENTRY(n##9)
+#define REGISTRY_ENTRY100(n) REGISTRY_ENTRY10(n##0) REGISTRY_ENTRY10(n##1) REGISTRY_ENTRY10(n##2) REGISTRY_ENTRY10(n##3) REGISTRY_ENTRY10(n##4) REGISTRY_ENTRY10(n##5) REGISTRY_ENTRY10(n##6) REGISTRY_ENTRY10(n##7) REGISTRY_ENTRY10(n##8) REGISTRY_ENTRY10(n##9)
+
+REGISTRY_ENTRY100(0)
+REGISTRY_ENTRY100(1)
+REGISTRY_ENTRY100(2)
+REGISTRY_ENTRY100(3)
+REGISTRY_ENTRY100(4)
+REGISTRY_ENTRY100(5)
+REGISTRY_ENTRY100(6)
+REGISTRY_ENTRY100(7)
+REGISTRY_ENTRY100(8)
+REGISTRY_ENTRY100(9)
+
+namespace
+{
+	// Lookups cycle through this many CLSIDs, registered ones unless miss is set
+	constexpr uint32_t lookup_count = 1024;
+
+	std::vector<GUID> lookup_clsids(bool miss)
+	{
+		std::vector<GUID> result;
+		for (uint32_t i = 0; i < lookup_count; ++i)
+			result.push_back(registry_clsid(miss ? 5000 + i : 1000 + (i * 7919) % 1000));
+		return result;
+	}
+
+	const belt::com::details::_OBJMAP_ENTRY *scan(const GUID &clsid) noexcept
+	{
+		for (auto p = belt::com::details::objmap_begin(); p < belt::com::details::objmap_end(); ++p)
+		{
+			if (*p && (*p)->clsid == clsid)
+				return *p;
+		}
+		return nullptr;
+	}
+
+	template<bool miss>
+	bench::body_t registry_find(unsigned)
+	{
+		return [clsids = lookup_clsids(miss)](unsigned, size_t iterations)
+		{
+			const auto &registry = belt::com::details::get_class_registry();
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto entry = registry.find(clsids[i % lookup_count]);
+				bench::do_not_optimize(entry);
+			}
+		};
+	}
+
+	template<bool miss>
+	bench::body_t section_scan(unsigned)
+	{
+		return [clsids = lookup_clsids(miss)](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				auto entry = scan(clsids[i % lookup_count]);
+				bench::do_not_optimize(entry);
+			}
+		};
+	}
+
+	bench::body_t create_object(unsigned)
+	{
+		return [clsids = lookup_clsids(false)](unsigned, size_t iterations)
+		{
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				bcom::ptr<IBench0> p;
+				belt::com::create_object(clsids[i % lookup_count], p);
+				bench::do_not_optimize(p);
+			}
+		};
+	}
+
+	bench::registrar r1{ "registry/find/hit", registry_find<false>, 20'000'000 };
+	bench::registrar r2{ "registry/find/miss", registry_find<true>, 20'000'000 };
+	bench::registrar r3{ "registry/create_object", create_object, 2'000'000 };
+	bench::registrar r4{ "registry/baseline/scan/hit", section_scan<false>, 200'000 };
+	bench::registrar r5{ "registry/baseline/scan/miss", section_scan<true>, 200'000 };
+}
@@ -0,0 +1,56 @@
+#include "harness.h"
+#include "objects.h"
+
+#include <memory>
+
+// Resolving a weak reference to an alive object, compared with std::weak_ptr::lock
+
+namespace
+{
+	struct weak_object
+	{
+		bcom::ptr<IBench0> strong;
+		bcom::weak_ref<IBench0> weak{ strong };
+	};
+
+	weak_object make_weak()
+	{
+		return { bench_small_weak::create_instance().to_ptr() };
+	}
+
+	void resolve(const weak_object &o) noexcept
+	{
+		auto p = o.weak.resolve();
+		bench::do_not_optimize(p);
+	}
+
+	// The object stays alive, but its weak reference is taken and released every time
+	void make_weak_ref(const weak_object &o) noexcept
+	{
+		bcom::weak_ref<IBench0> weak{ o.strong };
+		bench::do_not_optimize(weak);
+	}
+
+	struct std_weak_object
+	{
+		std::shared_ptr<int> strong{ std::make_shared<int>(0) };
+		std::weak_ptr<int> weak{ strong };
+	};
+
+	std_weak_object make_std_weak()
+	{
+		return {};
+	}
+
+	void lock(const std_weak_object &o) noexcept
+	{
+		auto p = o.weak.lock();
+		bench::do_not_optimize(p);
+	}
+
+	bench::registrar r1{ "weak_ref/resolve/shared", bench::shared_object(make_weak, resolve), 20'000'000 };
+	bench::registrar r2{ "weak_ref/resolve/private", bench::private_object(make_weak, resolve), 20'000'000 };
+	bench::registrar r3{ "weak_ref/create/private", bench::private_object(make_weak, make_weak_ref), 20'000'000 };
+	bench::registrar r4{ "weak_ref/baseline/weak_ptr_lock/shared", bench::shared_object(make_std_weak, lock), 20'000'000 };
+	bench::registrar r5{ "weak_ref/baseline/weak_ptr_lock/private", bench::private_object(make_std_weak, lock), 20'000'000 };
+}
@@ -0,0 +1,223 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <shared_mutex>
+
+#include "com_ptr.h"
+
+// The lock-free implementation keeps a pointer in the low 48 bits of a 64-bit word. User-mode pointers always fit them on
+// 32-bit platforms and on x64, where addresses above 128 TB (5-level paging) are only mapped on the process' explicit request.
+// Other 64-bit platforms may store tags in the high bits of pointers (ARM TBI and MTE) and use a lock
+#if !BELT_HAS_REF_COOKIES && !defined(BELT_COM_NO_LOCK_FREE_ATOMIC_PTR) && (UINTPTR_MAX == UINT32_MAX || defined(__x86_64__) || defined(_M_X64))
+	#define BELT_HAS_LOCK_FREE_ATOMIC_PTR 1
+#else
+	#define BELT_HAS_LOCK_FREE_ATOMIC_PTR 0
+#endif
+
+namespace belt::com
+{
+	namespace details
+	{
+#if !BELT_HAS_LOCK_FREE_ATOMIC_PTR
+		// Every reference must be paired with its leak detection cookie, which the lock-free implementation cannot do for the
+		// references it transfers between threads. Builds with leak detection or sampling, and platforms where pointers may not
+		// fit 48 bits, use a lock instead
+		template<class Interface>
+		class atomic_com_ptr
+		{
+			mutable srwlock lock;
+			com_ptr<Interface> value;
+
+		public:
+			static constexpr bool is_always_lock_free = false;
+
+			atomic_com_ptr() noexcept = default;
+			atomic_com_ptr(const atomic_com_ptr &) = delete;
+			atomic_com_ptr &operator =(const atomic_com_ptr &) = delete;
+
+			atomic_com_ptr(com_ptr<Interface> desired) noexcept :
+				value{ std::move(desired) }
+			{}
+
+			com_ptr<Interface> load() const noexcept
+			{
+				std::shared_lock l{ lock };
+				return value;
+			}
+
+			com_ptr<Interface> exchange(com_ptr<Interface> desired) noexcept
+			{
+				{
+					std::scoped_lock l{ lock };
+					std::swap(value, desired);
+				}
+				return desired;
+			}
+
+			bool compare_exchange(com_ptr<Interface> &expected, com_ptr<Interface> desired) noexcept
+			{
+				com_ptr<Interface> old;
+				{
+					std::scoped_lock l{ lock };
+					if (value != expected)
+					{
+						expected = value;
+						return false;
+					}
+					old = std::exchange(value, std::move(desired));
+				}
+				return true;
+			}
+#else
+		// Split reference count: the word holds the stored pointer and a number of readers that are about to add a reference
+		// to it. The stored pointer owns one reference. A writer that replaces the pointer adds a reference for each such
+		// reader, and these readers release the extra reference when they discover that the pointer has been replaced
+		template<class Interface>
+		class atomic_com_ptr
+		{
+			static constexpr unsigned count_shift = sizeof(void *) == 8 ? 48 : 32;
+			static constexpr uint64_t pointer_mask = (uint64_t{ 1 } << count_shift) - 1;
+			static constexpr uint64_t one = uint64_t{ 1 } << count_shift;
+
+			mutable std::atomic<uint64_t> word{};
+
+			static Interface *pointer(uint64_t value) noexcept
+			{
+				return reinterpret_cast<Interface *>(static_cast<uintptr_t>(value & pointer_mask));
+			}
+
+			static uint64_t count(uint64_t value) noexcept
+			{
+				return value >> count_shift;
+			}
+
+			static uint64_t pack(Interface *p) noexcept
+			{
+				const auto value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p));
+				// Truncated pointer would be dereferenced by the next load. Define BELT_COM_NO_LOCK_FREE_ATOMIC_PTR in processes
+				// that map memory above 128 TB
+				if (value & ~pointer_mask) [[unlikely]]
+					std::terminate();
+				return value;
+			}
+
+			// Takes ownership of the reference held by the replaced value
+			static com_ptr<Interface> adopt_replaced(uint64_t old) noexcept
+			{
+				auto p = pointer(old);
+				for (auto readers = count(old); readers; --readers)
+					p->AddRef();
+				return { attach, p };
+			}
+
+		public:
+			static constexpr bool is_always_lock_free = std::atomic<uint64_t>::is_always_lock_free;
+
+			atomic_com_ptr() noexcept = default;
+			atomic_com_ptr(const atomic_com_ptr &) = delete;
+			atomic_com_ptr &operator =(const atomic_com_ptr &) = delete;
+
+			atomic_com_ptr(com_ptr<Interface> desired) noexcept :
+				word{ pack(desired.detach()) }
+			{}
+
+			~atomic_com_ptr()
+			{
+				if (auto p = pointer(word.load(std::memory_order_acquire)))
+					p->Release();
+			}
+
+			com_ptr<Interface> load() const noexcept
+			{
+				auto current = word.load(std::memory_order_relaxed);
+				do
+				{
+					if (!pointer(current))
+						return {};
+				} while (!word.compare_exchange_weak(current, current + one, std::memory_order_acquire, std::memory_order_relaxed));
+
+				auto p = pointer(current);
+				p->AddRef();
+
+				auto expected = current + one;
+				while (!word.compare_exchange_weak(expected, expected - one, std::memory_order_release, std::memory_order_relaxed))
+				{
+					if (pointer(expected) != p || count(expected) == 0)
+					{
+						// The pointer has been replaced and the writer has added a reference on behalf of this thread
+						p->Release();
+						break;
+					}
+				}
+
+				return { attach, p };
+			}
+
+			com_ptr<Interface> exchange(com_ptr<Interface> desired) noexcept
+			{
+				return adopt_replaced(word.exchange(pack(desired.detach()), std::memory_order_acq_rel));
+			}
+
+			// Compares stored pointer with expected. On failure, expected receives the current value
+			bool compare_exchange(com_ptr<Interface> &expected, com_ptr<Interface> desired) noexcept
+			{
+				const auto desired_value = pack(desired.get());
+				auto current = word.load(std::memory_order_relaxed);
+				while (true)
+				{
+					if (pointer(current) != expected.get())
+					{
+						auto actual = load();
+						if (actual != expected)
+						{
+							expected = std::move(actual);
+							return false;
+						}
+						current = word.load(std::memory_order_relaxed);
+					}
+					else if (word.compare_exchange_weak(current, desired_value, std::memory_order_acq_rel, std::memory_order_relaxed))
+						break;
+				}
+
+				static_cast<void>(desired.detach());
+				adopt_replaced(current);
+				return true;
+			}
+#endif
+			void store(com_ptr<Interface> desired) noexcept
+			{
+				exchange(std::move(desired));
+			}
+
+			atomic_com_ptr &operator =(com_ptr<Interface> desired) noexcept
+			{
+				store(std::move(desired));
+				return *this;
+			}
+
+			operator com_ptr<Interface>() const noexcept
+			{
+				return load();
+			}
+		};
+	}
+
+	using details::atomic_com_ptr;
+}
+
+namespace bcom
+{
+	template<class T>
+	using atomic_ptr = belt::com::atomic_com_ptr<T>;
+}
@@ -16,6 +16,20 @@
 	#define BELT_HAS_LEAK_DETECTION 0
 #endif
 
+// Sampling leak profiler for optimized builds, see README. Full leak detection takes precedence
+#if defined(BELT_COM_LEAK_SAMPLING) && !BELT_HAS_LEAK_DETECTION
+	#define BELT_HAS_LEAK_SAMPLING 1
+#else
+	#define BELT_HAS_LEAK_SAMPLING 0
+#endif
+
+// com_ptr passes a cookie to and from the object's AddRef and Release to pair them
+#if BELT_HAS_LEAK_DETECTION || BELT_HAS_LEAK_SAMPLING
+	#define BELT_HAS_REF_COOKIES 1
+#else
+	#define BELT_HAS_REF_COOKIES 0
+#endif
+
 #if !defined(BELT_COM_NO_CHECKED_REFS) && defined(_DEBUG)
 	#define BELT_HAS_CHECKED_REFS 1
 #else
@@ -23,14 +37,11 @@
 #endif
 
 
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 #include <mutex>
 #include <atomic>
-// If you get a compilation error at the following line, do one of the following:
-//		- Add boost 1.73.0 or later to your project
-//		or
-//		- #define BELT_COM_NO_LEAK_DETECTION before including any library's header to disable leak detection
-#include <boost/stacktrace.hpp>
+#include "impl/cookie_channel.h"
+#include "impl/leak_table.h"
 #endif
 
 #if BELT_HAS_CHECKED_REFS
@@ -38,11 +49,10 @@
 #endif
 
 #include "guid.h"
+#include "impl/platform.h"
 #include "impl/srwlock.h"
 #include "impl/onexit.h"
 
-#include <unknwn.h>
-
 #include "impl/errors.h"
 
 namespace belt::com
@@ -51,76 +61,18 @@ namespace belt::com
 	{
 		template<class Interface>
 		class com_ptr;
-#if BELT_HAS_LEAK_DETECTION
-
-		struct leak_detection
-		{
-			int ordinal;
-			boost::stacktrace::stacktrace stack;
-
-			static int get_next() noexcept
-			{
-				static std::atomic<int> global_ordinal{};
-				return ++global_ordinal;
-			}
-
-			leak_detection() noexcept :
-				ordinal{ get_next() },
-				stack{ boost::stacktrace::stacktrace() }
-			{
-			}
-		};
-
+		// Leak detection no longer requires initialization, kept for compatibility
 		inline void init_leak_detection() noexcept
 		{
-			using namespace std::literals;
-			SYSTEM_INFO si{};
-			GetSystemInfo(&si);
-			HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, si.dwPageSize, (L"BELT_LEAK_DETECTION_SECTION."s + std::to_wstring(GetCurrentProcessId())).c_str());
-			*reinterpret_cast<DWORD *>(MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, si.dwPageSize)) = TlsAlloc();
-			// We intentionally leave section mapped
-		}
-
-		inline DWORD get_slot() noexcept
-		{
-			using namespace std::literals;
-			SYSTEM_INFO si{};
-			GetSystemInfo(&si);
-			HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, si.dwPageSize, (L"BELT_LEAK_DETECTION_SECTION."s + std::to_wstring(GetCurrentProcessId())).c_str());
-			assert(section && GetLastError() == ERROR_ALREADY_EXISTS && "init_leak_detection() must be called from EXE module as early as possible! It has not yet been called.");
-			auto ptr = reinterpret_cast<DWORD *>(MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, si.dwPageSize));
-			assert(ptr);
-			CloseHandle(section);
-			auto ret = *ptr;
-			UnmapViewOfFile(ptr);
-			return ret;
 		}
 
-		inline void set_current_cookie(int cookie) noexcept
-		{
-			static DWORD slot = get_slot();
-			TlsSetValue(slot, reinterpret_cast<void *>(static_cast<uintptr_t>(cookie)));
-		}
-
-		inline int get_current_cookie() noexcept
-		{
-			static DWORD slot = get_slot();
-			auto retval = TlsGetValue(slot);
-			TlsSetValue(slot, nullptr);
-			return static_cast<int>(reinterpret_cast<uint64_t>(retval));
-		}
-#else
-		inline void init_leak_detection() noexcept
-		{
-		}
-#endif
 		struct attach_t {};
 
 		template<class Interface>
 		class ref;
 
 		template<class Interface>
-		class __declspec(empty_bases) com_ptr
+		class BELT_EMPTY_BASES com_ptr
 		{
 			friend class ref<Interface>;
 
@@ -134,7 +86,7 @@ namespace belt::com
 			std::vector<ref<Interface> *> weaks;
 #endif
 
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 			int cookie{};
 
 			friend int &internal_get_cookie(com_ptr<Interface> &obj) noexcept
@@ -179,12 +131,12 @@ namespace belt::com
 			template<class OtherInterface>
 			com_ptr(com_ptr<OtherInterface> &&o, std::true_type) noexcept :
 				p{ static_cast<Interface *>(o.get()) }
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 				, cookie{ internal_get_cookie(o) }
 #endif
 			{
 				internal_get(o) = nullptr;
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 				internal_get_cookie(o) = 0;
 #endif
 			}
@@ -206,7 +158,7 @@ namespace belt::com
 				addref_pointer(p);
 			}
 
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 			void store_cookie() noexcept
 			{
 				cookie = get_current_cookie();
@@ -230,7 +182,7 @@ namespace belt::com
 			{
 				if (pint)
 				{
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 					set_current_cookie(std::exchange(cookie, 0));
 #endif
 					pint->Release();
@@ -315,19 +267,19 @@ namespace belt::com
 
 			com_ptr(com_ptr &&o) noexcept :
 				p{ o.p }
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 				, cookie {o.cookie }
 #endif
 			{
 				o.p = nullptr;
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 				o.cookie = 0;
 #endif
 			}
 
 			com_ptr &operator =(com_ptr &&o) noexcept
 			{
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 				std::swap(cookie, o.cookie);
 #endif
 				std::swap(p, o.p);
@@ -389,7 +341,7 @@ namespace belt::com
 			{
 				Interface *cur{};
 				std::swap(cur, p);
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 				cookie = 0;
 #endif
 
@@ -402,7 +354,7 @@ namespace belt::com
 				return p;
 			}
 
-#if BELT_HAS_LEAK_DETECTION
+#if BELT_HAS_REF_COOKIES
 			int get_cookie() const noexcept
 			{
 				return cookie;
@@ -416,10 +368,10 @@ namespace belt::com
 			}
 
 			// Conversion operations
-			template<class Interface>
+			template<class OtherInterface>
 			auto as() const noexcept
 			{
-				return com_ptr<Interface>{*this};
+				return com_ptr<OtherInterface>{*this};
 			}
 
 			template<class T>
@@ -471,7 +423,7 @@ namespace belt::com
 
 
 		template<class Interface>
-		class __declspec(empty_bases) ref
+		class BELT_EMPTY_BASES ref
 		{
 			Interface *p{};
 #if BELT_HAS_CHECKED_REFS
@@ -629,10 +581,10 @@ namespace belt::com
 			}
 
 			// Conversion operations
-			template<class Interface>
+			template<class OtherInterface>
 			auto as() const noexcept
 			{
-				return com_ptr<Interface>{ p };
+				return com_ptr<OtherInterface>{ p };
 			}
 		};
 
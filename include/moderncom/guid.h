@@ -9,11 +9,40 @@
 
 #pragma once
 #include <stdexcept>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <compare>
+#include <random>
 #include <string>
+#include <string_view>
+#include <optional>
+#include <span>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <utility>
 #include <functional>
+#include <iosfwd>
+#include <version>
+
+// Runtime GUID parsing and formatting use SSE2 when it is available. Define BELT_HAS_SSE2 to 0 to always use portable code
+#if !defined(BELT_HAS_SSE2)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BELT_HAS_SSE2 1
+#else
+#define BELT_HAS_SSE2 0
+#endif
+#endif
+
+#if BELT_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
 
 #if !defined(GUID_DEFINED)
 #define GUID_DEFINED
@@ -23,19 +52,26 @@ struct GUID {
 	uint16_t Data3;
 	uint8_t Data4[8];
 };
+
+#if !defined(_WIN32)
+// Windows SDK provides this operator in guiddef.h
+constexpr bool operator ==(const GUID &a, const GUID &b) noexcept
+{
+	return std::bit_cast<std::array<uint64_t, 2>>(a) == std::bit_cast<std::array<uint64_t, 2>>(b);
+}
+#endif
 #endif
 
 namespace belt::com
 {
 	namespace details
 	{
-		constexpr const size_t short_guid_form_length = 36;	// {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}
-		constexpr const size_t long_guid_form_length = 38;	// XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX
+		constexpr const size_t short_guid_form_length = 36;	// XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX
+		constexpr const size_t long_guid_form_length = 38;	// {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}
 
-		//
-		constexpr int parse_hex_digit(const char c)
+		// Returns -1 for a character that is not a hexadecimal digit
+		constexpr int hex_digit_value(const char c) noexcept
 		{
-			using namespace std::string_literals;
 			if ('0' <= c && c <= '9')
 				return c - '0';
 			else if ('a' <= c && c <= 'f')
@@ -43,37 +79,464 @@ namespace belt::com
 			else if ('A' <= c && c <= 'F')
 				return 10 + c - 'A';
 			else
+				return -1;
+		}
+
+		constexpr int parse_hex_digit(const char c)
+		{
+			using namespace std::string_literals;
+			auto value = hex_digit_value(c);
+			if (value < 0)
 				throw std::domain_error{ "invalid character in GUID"s };
+			return value;
 		}
 
-		template<class T>
-		constexpr T parse_hex(const char *ptr)
+		// Offsets of the digit pairs of each byte in the short form, in text order
+		inline constexpr size_t guid_byte_offsets[16] = { 0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34 };
+
+		constexpr bool has_guid_dashes(const char *begin) noexcept
 		{
-			constexpr size_t digits = sizeof(T) * 2;
-			T result{};
-			for (size_t i = 0; i < digits; ++i)
-				result |= parse_hex_digit(ptr[i]) << (4 * (digits - i - 1));
-			return result;
+			return begin[8] == '-' && begin[13] == '-' && begin[18] == '-' && begin[23] == '-';
 		}
 
-		constexpr GUID make_guid_helper(const char *begin)
+		// Bytes in text order: Data1, Data2 and Data3 are big-endian
+		constexpr GUID guid_from_bytes(const uint8_t *bytes) noexcept
 		{
 			GUID result{};
-			result.Data1 = parse_hex<uint32_t>(begin);
-			begin += 8 + 1;
-			result.Data2 = parse_hex<uint16_t>(begin);
-			begin += 4 + 1;
-			result.Data3 = parse_hex<uint16_t>(begin);
-			begin += 4 + 1;
-			result.Data4[0] = parse_hex<uint8_t>(begin);
-			begin += 2;
-			result.Data4[1] = parse_hex<uint8_t>(begin);
-			begin += 2 + 1;
-			for (size_t i = 0; i < 6; ++i)
-				result.Data4[i + 2] = parse_hex<uint8_t>(begin + i * 2);
+			result.Data1 = static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+			result.Data2 = static_cast<uint16_t>(bytes[4] << 8 | bytes[5]);
+			result.Data3 = static_cast<uint16_t>(bytes[6] << 8 | bytes[7]);
+			for (size_t i = 0; i < 8; ++i)
+				result.Data4[i] = bytes[i + 8];
 			return result;
 		}
 
+		// Parses 36 characters of the short form
+		constexpr std::optional<GUID> parse_guid_scalar(const char *begin) noexcept
+		{
+			if (!has_guid_dashes(begin))
+				return std::nullopt;
+
+			uint8_t bytes[16]{};
+			for (size_t i = 0; i < 16; ++i)
+			{
+				auto high = hex_digit_value(begin[guid_byte_offsets[i]]);
+				auto low = hex_digit_value(begin[guid_byte_offsets[i] + 1]);
+				if (high < 0 || low < 0)
+					return std::nullopt;
+				bytes[i] = static_cast<uint8_t>(high << 4 | low);
+			}
+			return guid_from_bytes(bytes);
+		}
+
+#if BELT_HAS_SSE2
+		// Converts 16 hexadecimal digits to their values and clears bytes of valid that do not hold a digit
+		inline __m128i hex_digit_values(__m128i chars, __m128i &valid) noexcept
+		{
+			const auto lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+			const auto digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+			const auto letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+			valid = _mm_and_si128(valid, _mm_or_si128(digit, letter));
+			return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(chars, _mm_set1_epi8('0'))), _mm_and_si128(letter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+		}
+
+		// Combines pairs of digit values into bytes, stored in the low half of each 16-bit lane
+		inline __m128i hex_pairs(__m128i values) noexcept
+		{
+			return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(values, 8));
+		}
+
+		// Parses 36 characters of the short form. Three overlapping loads are shifted to move the 32 digits together
+		inline std::optional<GUID> parse_guid_sse2(const char *begin) noexcept
+		{
+			if (!has_guid_dashes(begin))
+				return std::nullopt;
+
+			const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+			const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + 16));
+			const auto v2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin + 20));
+
+			// Digits 0-15 are at offsets 0-7, 9-12 and 14-17, digits 16-31 at offsets 19-22 and 24-35
+			const auto low = _mm_or_si128(
+				_mm_or_si128(_mm_and_si128(v0, _mm_set_epi64x(0, -1)), _mm_and_si128(_mm_srli_si128(v0, 1), _mm_set_epi32(0, -1, 0, 0))),
+				_mm_or_si128(_mm_and_si128(_mm_srli_si128(v0, 2), _mm_set_epi16(0, -1, 0, 0, 0, 0, 0, 0)), _mm_slli_si128(v1, 14)));
+			const auto high = _mm_or_si128(_mm_and_si128(_mm_srli_si128(v1, 3), _mm_set_epi32(0, 0, 0, -1)), _mm_and_si128(v2, _mm_set_epi32(-1, -1, -1, 0)));
+
+			auto valid = _mm_set1_epi8(-1);
+			const auto bytes = _mm_packus_epi16(hex_pairs(hex_digit_values(low, valid)), hex_pairs(hex_digit_values(high, valid)));
+			if (_mm_movemask_epi8(valid) != 0xffff)
+				return std::nullopt;
+
+			// Data1, Data2 and Data3 are stored little-endian
+			const auto swapped = _mm_or_si128(_mm_slli_epi16(bytes, 8), _mm_srli_epi16(bytes, 8));
+			const auto fields = _mm_shufflelo_epi16(swapped, _MM_SHUFFLE(3, 2, 0, 1));
+			const auto result_bytes = _mm_castpd_si128(_mm_move_sd(_mm_castsi128_pd(bytes), _mm_castsi128_pd(fields)));
+
+			GUID result;
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(&result), result_bytes);
+			return result;
+		}
+#endif
+
+		constexpr GUID make_guid_helper(const char *begin)
+		{
+			using namespace std::string_literals;
+			if (auto result = parse_guid_scalar(begin))
+				return *result;
+			throw std::domain_error{ "invalid character in GUID"s };
+		}
+
+		// Returns the first digit of a GUID string in the short or long form, or nullptr
+		constexpr const char *guid_digits(std::string_view str) noexcept
+		{
+			if (str.size() == short_guid_form_length)
+				return str.data();
+			if (str.size() == long_guid_form_length && str.front() == '{' && str.back() == '}')
+				return str.data() + 1;
+			return nullptr;
+		}
+
+		// Accepts GUIDs in the form {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX} or XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX
+		constexpr std::optional<GUID> parse_guid(std::string_view str) noexcept
+		{
+			auto digits = guid_digits(str);
+			if (!digits)
+				return std::nullopt;
+#if BELT_HAS_SSE2
+			if (!std::is_constant_evaluated())
+				return parse_guid_sse2(digits);
+#endif
+			return parse_guid_scalar(digits);
+		}
+
+		// Parses each string into the corresponding element of result, which must be at least as large. Strings that are not
+		// valid GUIDs produce null GUIDs. Returns the number of valid strings
+		inline size_t parse_guids(std::span<const std::string_view> strings, std::span<GUID> result) noexcept
+		{
+			assert(result.size() >= strings.size());
+			size_t parsed{};
+			for (size_t i = 0; i < strings.size(); ++i)
+			{
+				auto guid = parse_guid(strings[i]);
+				parsed += guid.has_value();
+				result[i] = guid.value_or(GUID{});
+			}
+			return parsed;
+		}
+
+		// Writes the digits of bytes in text order to 32 characters
+		constexpr void guid_bytes_to_hex(const uint8_t *bytes, char *out) noexcept
+		{
+			constexpr const char *digits = "0123456789ABCDEF";
+			for (size_t i = 0; i < 16; ++i)
+			{
+				out[i * 2] = digits[bytes[i] >> 4];
+				out[i * 2 + 1] = digits[bytes[i] & 0xf];
+			}
+		}
+
+		// Writes 36 characters of the short form
+		constexpr void format_guid_scalar(const GUID &guid, char *out) noexcept
+		{
+			const uint8_t bytes[16]{
+				static_cast<uint8_t>(guid.Data1 >> 24), static_cast<uint8_t>(guid.Data1 >> 16), static_cast<uint8_t>(guid.Data1 >> 8), static_cast<uint8_t>(guid.Data1),
+				static_cast<uint8_t>(guid.Data2 >> 8), static_cast<uint8_t>(guid.Data2), static_cast<uint8_t>(guid.Data3 >> 8), static_cast<uint8_t>(guid.Data3),
+				guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3], guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7],
+			};
+			char hex[32]{};
+			guid_bytes_to_hex(bytes, hex);
+			for (size_t i = 0, digit = 0; i < short_guid_form_length; ++i)
+				out[i] = (i == 8 || i == 13 || i == 18 || i == 23) ? '-' : hex[digit++];
+		}
+
+#if BELT_HAS_SSE2
+		// Converts values 0-15 in each byte to uppercase hexadecimal digits
+		inline __m128i hex_digit_chars(__m128i values) noexcept
+		{
+			const auto letters = _mm_and_si128(_mm_cmpgt_epi8(values, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10));
+			return _mm_add_epi8(_mm_add_epi8(values, _mm_set1_epi8('0')), letters);
+		}
+
+		// Writes 36 characters of the short form. Digits are inserted between the dashes with byte shifts
+		inline void format_guid_sse2(const GUID &guid, char *out) noexcept
+		{
+			const auto raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&guid));
+
+			// Bytes in text order, the same transformation as in parse_guid_sse2
+			const auto swapped = _mm_or_si128(_mm_slli_epi16(raw, 8), _mm_srli_epi16(raw, 8));
+			const auto fields = _mm_shufflelo_epi16(swapped, _MM_SHUFFLE(3, 2, 0, 1));
+			const auto bytes = _mm_castpd_si128(_mm_move_sd(_mm_castsi128_pd(raw), _mm_castsi128_pd(fields)));
+
+			const auto mask = _mm_set1_epi8(0x0f);
+			const auto high_nibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+			const auto low_nibbles = _mm_and_si128(bytes, mask);
+			// Digits 0-15 and 16-31
+			const auto low = hex_digit_chars(_mm_unpacklo_epi8(high_nibbles, low_nibbles));
+			const auto high = hex_digit_chars(_mm_unpackhi_epi8(high_nibbles, low_nibbles));
+
+			// Offsets 0-15 hold digits 0-7, 8-11 and 12-13, offsets 16-31 hold digits 14-15, 16-19 and 20-27
+			const auto dashes0 = _mm_set_epi8(0, 0, '-', 0, 0, 0, 0, '-', 0, 0, 0, 0, 0, 0, 0, 0);
+			const auto dashes1 = _mm_set_epi8(0, 0, 0, 0, 0, 0, 0, 0, '-', 0, 0, 0, 0, '-', 0, 0);
+			const auto out0 = _mm_or_si128(_mm_or_si128(
+				_mm_and_si128(low, _mm_set_epi64x(0, -1)),
+				_mm_and_si128(_mm_slli_si128(low, 1), _mm_set_epi8(0, 0, 0, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0))),
+				_mm_or_si128(_mm_and_si128(_mm_slli_si128(low, 2), _mm_set_epi8(-1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)), dashes0));
+			const auto out1 = _mm_or_si128(_mm_or_si128(
+				_mm_srli_si128(low, 14),
+				_mm_and_si128(_mm_slli_si128(high, 3), _mm_set_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, 0, 0, 0))),
+				_mm_or_si128(_mm_and_si128(_mm_slli_si128(high, 4), _mm_set_epi64x(-1, 0)), dashes1));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out), out0);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), out1);
+			const auto tail = _mm_cvtsi128_si32(_mm_srli_si128(high, 12));
+			std::memcpy(out + 32, &tail, 4);
+		}
+#endif
+
+		// Writes the GUID in the form {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}, or without braces, with uppercase digits. Returns
+		// the pointer past the last written character, no terminating null character is written
+		constexpr char *to_chars(char *first, const GUID &guid, bool braces = true) noexcept
+		{
+			if (braces)
+				*first++ = '{';
+#if BELT_HAS_SSE2
+			if (!std::is_constant_evaluated())
+				format_guid_sse2(guid, first);
+			else
+#endif
+				format_guid_scalar(guid, first);
+			first += short_guid_form_length;
+			if (braces)
+				*first++ = '}';
+			return first;
+		}
+
+		static_assert(sizeof(GUID) == 2 * sizeof(uint64_t), "Unexpected GUID layout");
+
+		// The two halves of a GUID as stored in memory
+		constexpr std::array<uint64_t, 2> guid_words(const GUID &guid) noexcept
+		{
+			return std::bit_cast<std::array<uint64_t, 2>>(guid);
+		}
+
+		// Compares both halves without branches
+		constexpr bool equal_guids(const GUID &a, const GUID &b) noexcept
+		{
+			const auto x = guid_words(a);
+			const auto y = guid_words(b);
+			return ((x[0] ^ y[0]) | (x[1] ^ y[1])) == 0;
+		}
+
+		// Mixes both halves into all bits of the result. Until the final mixing step, which is a bijection, GUIDs that differ in
+		// one half only never collide, so sequentially allocated CLSIDs and IIDs are spread over the whole range
+		constexpr size_t hash_guid(const GUID &guid) noexcept
+		{
+			const auto words = guid_words(guid);
+			auto hash = words[0] * 0x9e3779b97f4a7c15ull ^ words[1];
+			hash = (hash ^ (hash >> 32)) * 0xd6e8feb86659fd93ull;
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+
+		constexpr uint64_t byte_swap(uint64_t value) noexcept
+		{
+#if defined(__cpp_lib_byteswap)
+			return std::byteswap(value);
+#elif defined(__GNUC__)
+			return __builtin_bswap64(value);
+#else
+			value = (value & 0x00ff00ff00ff00ffull) << 8 | (value >> 8 & 0x00ff00ff00ff00ffull);
+			value = (value & 0x0000ffff0000ffffull) << 16 | (value >> 16 & 0x0000ffff0000ffffull);
+			return value << 32 | value >> 32;
+#endif
+		}
+
+		// The bytes of a GUID in text order as two big-endian numbers
+		constexpr std::array<uint64_t, 2> guid_text_words(const GUID &guid) noexcept
+		{
+			const auto words = guid_words(guid);
+			if constexpr (std::endian::native == std::endian::big)
+				return words;
+			else
+				return { (words[0] & 0xffffffff) << 32 | (words[0] >> 16 & 0xffff0000) | words[0] >> 48, byte_swap(words[1]) };
+		}
+
+		constexpr GUID guid_from_text_words(uint64_t head, uint64_t tail) noexcept
+		{
+			if constexpr (std::endian::native == std::endian::big)
+				return std::bit_cast<GUID>(std::array{ head, tail });
+			else
+				return std::bit_cast<GUID>(std::array{ head >> 32 | (head & 0xffff0000) << 16 | head << 48, byte_swap(tail) });
+		}
+
+		// Orders GUIDs the same way as their string forms
+		constexpr std::strong_ordering compare_guids(const GUID &a, const GUID &b) noexcept
+		{
+			return guid_text_words(a) <=> guid_text_words(b);
+		}
+
+		// Incremented in the child process after fork, so that generators do not repeat the parent's sequence
+		inline std::atomic<uint32_t> &guid_fork_generation() noexcept
+		{
+			static std::atomic<uint32_t> generation{};
+			return generation;
+		}
+
+		// xoshiro256++
+		struct guid_random
+		{
+			uint64_t state[4];
+
+			uint64_t operator()() noexcept
+			{
+				const auto result = std::rotl(state[0] + state[3], 23) + state[0];
+				const auto t = state[1] << 17;
+				state[2] ^= state[0];
+				state[3] ^= state[1];
+				state[1] ^= state[2];
+				state[0] ^= state[3];
+				state[2] ^= t;
+				state[3] = std::rotl(state[3], 45);
+				return result;
+			}
+		};
+
+		// One per thread, seeded from std::random_device. The output is unpredictable to other parties, but GUIDs must not be
+		// used as secrets, as the output of the generator reveals its further output. Batches are generated with a copy of the
+		// state kept in registers
+		class guid_generator
+		{
+			guid_random random;
+			uint32_t generation;
+			// Version 7: the last timestamp and the counter that follows it. The counter starts at a random value below 2^25
+			// every millisecond, leaving room for at least 2^25 GUIDs per millisecond
+			uint64_t last_ms{};
+			uint32_t counter{};
+
+			static constexpr unsigned counter_bits = 26;
+
+			void seed()
+			{
+#if !defined(_WIN32)
+				[[maybe_unused]] static const bool registered = 0 == pthread_atfork(nullptr, nullptr, []() noexcept { guid_fork_generation().fetch_add(1, std::memory_order_relaxed); });
+#endif
+				std::random_device source;
+				for (auto &word : random.state)
+					word = uint64_t{ source() } << 32 | source();
+				generation = guid_fork_generation().load(std::memory_order_relaxed);
+			}
+
+			// Random GUID as defined by RFC 4122: 122 random bits, version 4, variant 10
+			static GUID make_v4(guid_random &random) noexcept
+			{
+				auto guid = std::bit_cast<GUID>(std::array{ random(), random() });
+				guid.Data3 = static_cast<uint16_t>((guid.Data3 & 0x0fff) | 0x4000);
+				guid.Data4[0] = static_cast<uint8_t>((guid.Data4[0] & 0x3f) | 0x80);
+				return guid;
+			}
+
+			// Time-ordered GUID as defined by RFC 9562: 48-bit Unix time in milliseconds, version 7, a 26-bit counter that spans
+			// rand_a and the first bits of rand_b (method 1 of section 6.2), variant 10 and 48 random bits. GUIDs made by one
+			// thread are strictly increasing in compare_guids order, even if the clock goes back. If the counter overflows, the
+			// timestamp is advanced by a millisecond
+			static GUID make_v7(guid_random &random, uint64_t &last_ms, uint32_t &counter, uint64_t now_ms) noexcept
+			{
+				if (now_ms > last_ms)
+				{
+					last_ms = now_ms;
+					counter = static_cast<uint32_t>(random() >> (64 - counter_bits + 1));
+				}
+				else if (++counter >> counter_bits) [[unlikely]]
+				{
+					++last_ms;
+					counter = static_cast<uint32_t>(random() >> (64 - counter_bits + 1));
+				}
+
+				const auto head = last_ms << 16 | 0x7000 | counter >> 14;
+				const auto tail = uint64_t{ 0x80 | (counter >> 8 & 0x3f) } << 56 | uint64_t{ counter & 0xff } << 48 | random() >> 16;
+				return guid_from_text_words(head, tail);
+			}
+
+		public:
+			guid_generator()
+			{
+				seed();
+			}
+
+			guid_generator(const guid_generator &) = delete;
+			guid_generator &operator =(const guid_generator &) = delete;
+
+			void check_fork()
+			{
+				if (generation != guid_fork_generation().load(std::memory_order_relaxed)) [[unlikely]]
+					seed();
+			}
+
+			GUID v4() noexcept
+			{
+				return make_v4(random);
+			}
+
+			void v4(std::span<GUID> result) noexcept
+			{
+				auto local = random;
+				for (auto &guid : result)
+					guid = make_v4(local);
+				random = local;
+			}
+
+			GUID v7(uint64_t now_ms) noexcept
+			{
+				return make_v7(random, last_ms, counter, now_ms);
+			}
+
+			void v7(std::span<GUID> result, uint64_t now_ms) noexcept
+			{
+				auto local = random;
+				auto local_ms = last_ms;
+				auto local_counter = counter;
+				for (auto &guid : result)
+					guid = make_v7(local, local_ms, local_counter, now_ms);
+				random = local;
+				last_ms = local_ms;
+				counter = local_counter;
+			}
+		};
+
+		inline guid_generator &get_guid_generator()
+		{
+			static thread_local guid_generator instance;
+			instance.check_fork();
+			return instance;
+		}
+
+		inline uint64_t unix_time_ms() noexcept
+		{
+			using namespace std::chrono;
+			return static_cast<uint64_t>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+		}
+
+		// The first call on a thread seeds the thread's generator, which throws if std::random_device fails
+		inline GUID generate_guid()
+		{
+			return get_guid_generator().v4();
+		}
+
+		inline GUID generate_guid_v7()
+		{
+			return get_guid_generator().v7(unix_time_ms());
+		}
+
+		inline void generate_guids(std::span<GUID> result)
+		{
+			get_guid_generator().v4(result);
+		}
+
+		// Reads the clock once, GUIDs of a batch share a timestamp unless the counter overflows
+		inline void generate_guids_v7(std::span<GUID> result)
+		{
+			get_guid_generator().v7(result, unix_time_ms());
+		}
+
 		template<size_t N>
 		constexpr GUID make_guid(const char(&str)[N])
 		{
@@ -134,7 +597,12 @@ namespace belt::com
 		template<class T>
 		constexpr GUID get_interface_guid_impl(std::false_type, std::false_type) noexcept
 		{
+#if defined(_MSC_VER)
 			return __uuidof(T);
+#else
+			static_assert(sizeof(T) == 0, "Interface has no GUID attached. Use BELT_DEFINE_INTERFACE or provide get_guid for it");
+			return {};
+#endif
 		}
 
 		//
@@ -148,6 +616,16 @@ namespace belt::com
 		}
 	}
 	using details::make_guid;
+	using details::parse_guid;
+	using details::parse_guids;
+	using details::to_chars;
+	using details::equal_guids;
+	using details::hash_guid;
+	using details::compare_guids;
+	using details::generate_guid;
+	using details::generate_guid_v7;
+	using details::generate_guids;
+	using details::generate_guids_v7;
 
 	namespace literals
 	{
@@ -167,3 +645,27 @@ namespace belt::com
 }
 
 using namespace belt::com::literals;
+
+constexpr std::strong_ordering operator <=>(const GUID &a, const GUID &b) noexcept
+{
+	return belt::com::compare_guids(a, b);
+}
+
+namespace std
+{
+	template<>
+	struct hash<GUID>
+	{
+		constexpr size_t operator()(const GUID &guid) const noexcept
+		{
+			return belt::com::hash_guid(guid);
+		}
+	};
+}
+
+template<class Traits>
+inline std::basic_ostream<char, Traits> &operator <<(std::basic_ostream<char, Traits> &os, const GUID &guid)
+{
+	char buffer[belt::com::details::long_guid_form_length];
+	return os.write(buffer, belt::com::to_chars(buffer, guid) - buffer);
+}
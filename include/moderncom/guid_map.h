@@ -0,0 +1,573 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "guid.h"
+
+// GUID-keyed hash map
+//
+// An open-addressing table split into groups of 16 slots. Each slot has a control byte that is either empty, deleted or holds
+// 7 bits of the key's hash. A lookup loads the control bytes of a group and compares all of them to the hash bits at once, then
+// compares the keys of the matching slots only. Groups are probed in triangular order until a group with an empty slot is found.
+// Elements are stored in a separate array, so the control bytes of a group fit into one cache line.
+
+namespace belt::com
+{
+	namespace details
+	{
+		inline constexpr int8_t guid_map_empty = -128;
+		inline constexpr int8_t guid_map_deleted = -2;
+
+		// Bit masks of the slots of a group whose control bytes satisfy a condition
+		struct guid_map_group
+		{
+			static constexpr size_t width = 16;
+
+#if BELT_HAS_SSE2
+			__m128i ctrl;
+
+			explicit guid_map_group(const int8_t *p) noexcept :
+				ctrl{ _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)) }
+			{}
+
+			uint32_t match(int8_t tag) const noexcept
+			{
+				return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), ctrl)));
+			}
+
+			uint32_t match_empty() const noexcept
+			{
+				return match(guid_map_empty);
+			}
+
+			// Empty and deleted slots are the only ones with the high bit set
+			uint32_t match_free() const noexcept
+			{
+				return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+			}
+#else
+			const int8_t *ctrl;
+
+			explicit guid_map_group(const int8_t *p) noexcept :
+				ctrl{ p }
+			{}
+
+			uint32_t match(int8_t tag) const noexcept
+			{
+				uint32_t result{};
+				for (size_t i = 0; i < width; ++i)
+					result |= uint32_t{ ctrl[i] == tag } << i;
+				return result;
+			}
+
+			uint32_t match_empty() const noexcept
+			{
+				return match(guid_map_empty);
+			}
+
+			uint32_t match_free() const noexcept
+			{
+				uint32_t result{};
+				for (size_t i = 0; i < width; ++i)
+					result |= uint32_t{ ctrl[i] < 0 } << i;
+				return result;
+			}
+#endif
+		};
+
+		struct guid_map_stats
+		{
+			size_t size;
+			// Number of slots, a power of two
+			size_t capacity;
+			// Slots of erased elements that are not yet reused
+			size_t deleted;
+			// Average and maximum number of groups examined to find an element
+			double average_probes;
+			size_t max_probes;
+			// Average number of groups examined to find out that a key is not in the map
+			double average_miss_probes;
+		};
+
+		template<class V>
+		class guid_map
+		{
+		public:
+			using key_type = GUID;
+			using mapped_type = V;
+			using value_type = std::pair<const GUID, V>;
+			using size_type = size_t;
+
+		private:
+			static constexpr size_t width = guid_map_group::width;
+
+			union slot
+			{
+				value_type value;
+
+				slot() noexcept {}
+				~slot() {}
+			};
+
+			int8_t *ctrl{};
+			slot *slots{};
+			size_t capacity_{};
+			size_t size_{};
+			size_t deleted{};
+
+			static constexpr int8_t tag_of(size_t hash) noexcept
+			{
+				return static_cast<int8_t>(hash & 0x7f);
+			}
+
+			size_t group_mask() const noexcept
+			{
+				return capacity_ / width - 1;
+			}
+
+			size_t max_load() const noexcept
+			{
+				return capacity_ - capacity_ / 8;
+			}
+
+			// Calls f with the first slot of each group in probe order until it returns true
+			template<class F>
+			void probe(size_t hash, F &&f) const
+			{
+				const auto mask = group_mask();
+				auto group = (hash >> 7) & mask;
+				for (size_t step = 1;; group = (group + step++) & mask)
+				{
+					if (f(group * width))
+						return;
+				}
+			}
+
+			size_t find_index(const GUID &key) const noexcept
+			{
+				if (!size_)
+					return capacity_;
+				const auto hash = hash_guid(key);
+				const auto tag = tag_of(hash);
+				const auto mask = group_mask();
+				auto group = (hash >> 7) & mask;
+				for (size_t step = 1;; group = (group + step++) & mask)
+				{
+					const auto first = group * width;
+					const guid_map_group ctrl_group{ ctrl + first };
+					for (auto match = ctrl_group.match(tag); match; match &= match - 1)
+					{
+						const auto index = first + std::countr_zero(match);
+						if (equal_guids(slots[index].value.first, key))
+							return index;
+					}
+					if (ctrl_group.match_empty())
+						return capacity_;
+				}
+			}
+
+			// First free slot in probe order for a key that is not in the map
+			size_t find_free(size_t hash) const noexcept
+			{
+				size_t result{};
+				probe(hash, [&](size_t first) noexcept
+				{
+					if (auto free = guid_map_group{ ctrl + first }.match_free())
+					{
+						result = first + std::countr_zero(free);
+						return true;
+					}
+					return false;
+				});
+				return result;
+			}
+
+			void allocate(size_t capacity)
+			{
+				std::unique_ptr<int8_t[]> new_ctrl{ new int8_t[capacity] };
+				slots = std::allocator<slot>{}.allocate(capacity);
+				ctrl = new_ctrl.release();
+				std::fill_n(ctrl, capacity, guid_map_empty);
+				capacity_ = capacity;
+			}
+
+			void deallocate() noexcept
+			{
+				if (capacity_)
+				{
+					std::allocator<slot>{}.deallocate(slots, capacity_);
+					delete[] ctrl;
+				}
+				ctrl = nullptr;
+				slots = nullptr;
+				capacity_ = 0;
+			}
+
+			void destroy_elements() noexcept
+			{
+				for (size_t i = 0; i < capacity_; ++i)
+				{
+					if (ctrl[i] >= 0)
+						slots[i].value.~value_type();
+				}
+			}
+
+			// Moves all elements to a new table, which also drops deleted slots
+			void rehash(size_t capacity)
+			{
+				guid_map other;
+				other.allocate(capacity);
+				for (size_t i = 0; i < capacity_; ++i)
+				{
+					if (ctrl[i] >= 0)
+					{
+						auto &value = slots[i].value;
+						other.insert_new(hash_guid(value.first), value.first, std::move_if_noexcept(value.second));
+					}
+				}
+				swap(other);
+			}
+
+			// Grows the table if one more element does not fit
+			void prepare_insert()
+			{
+				if (size_ + deleted + 1 <= max_load())
+					return;
+				// Only drop deleted slots if the elements take less than half of the table
+				rehash(!capacity_ ? width : size_ + 1 <= capacity_ / 2 ? capacity_ : capacity_ * 2);
+			}
+
+			template<class...Args>
+			size_t insert_new(size_t hash, const GUID &key, Args &&...args)
+			{
+				const auto index = find_free(hash);
+				::new (static_cast<void *>(&slots[index].value)) value_type{ std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...) };
+				if (ctrl[index] == guid_map_deleted)
+					--deleted;
+				ctrl[index] = tag_of(hash);
+				++size_;
+				return index;
+			}
+
+			template<bool Const>
+			class iterator_base
+			{
+				friend class guid_map;
+				friend class iterator_base<true>;
+				using map_t = std::conditional_t<Const, const guid_map, guid_map>;
+
+				map_t *map{};
+				size_t index{};
+
+				iterator_base(map_t *map, size_t index) noexcept :
+					map{ map },
+					index{ index }
+				{}
+
+				void skip_free() noexcept
+				{
+					while (index < map->capacity_ && map->ctrl[index] < 0)
+						++index;
+				}
+
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = guid_map::value_type;
+				using difference_type = ptrdiff_t;
+				using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+				using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+				iterator_base() noexcept = default;
+
+				operator iterator_base<true>() const noexcept
+				{
+					return { map, index };
+				}
+
+				reference operator *() const noexcept
+				{
+					return map->slots[index].value;
+				}
+
+				pointer operator ->() const noexcept
+				{
+					return &map->slots[index].value;
+				}
+
+				iterator_base &operator ++() noexcept
+				{
+					++index;
+					skip_free();
+					return *this;
+				}
+
+				iterator_base operator ++(int) noexcept
+				{
+					auto result = *this;
+					++*this;
+					return result;
+				}
+
+				bool operator ==(const iterator_base &o) const noexcept
+				{
+					return index == o.index;
+				}
+			};
+
+		public:
+			using iterator = iterator_base<false>;
+			using const_iterator = iterator_base<true>;
+
+			guid_map() noexcept = default;
+
+			guid_map(std::initializer_list<value_type> values) :
+				guid_map{}
+			{
+				reserve(values.size());
+				for (const auto &value : values)
+					try_emplace(value.first, value.second);
+			}
+
+			guid_map(const guid_map &o) :
+				guid_map{}
+			{
+				reserve(o.size_);
+				for (const auto &value : o)
+					insert_new(hash_guid(value.first), value.first, value.second);
+			}
+
+			guid_map(guid_map &&o) noexcept :
+				ctrl{ std::exchange(o.ctrl, nullptr) },
+				slots{ std::exchange(o.slots, nullptr) },
+				capacity_{ std::exchange(o.capacity_, 0) },
+				size_{ std::exchange(o.size_, 0) },
+				deleted{ std::exchange(o.deleted, 0) }
+			{}
+
+			~guid_map()
+			{
+				destroy_elements();
+				deallocate();
+			}
+
+			guid_map &operator =(guid_map o) noexcept
+			{
+				swap(o);
+				return *this;
+			}
+
+			void swap(guid_map &o) noexcept
+			{
+				std::swap(ctrl, o.ctrl);
+				std::swap(slots, o.slots);
+				std::swap(capacity_, o.capacity_);
+				std::swap(size_, o.size_);
+				std::swap(deleted, o.deleted);
+			}
+
+			iterator begin() noexcept
+			{
+				iterator result{ this, 0 };
+				result.skip_free();
+				return result;
+			}
+
+			const_iterator begin() const noexcept
+			{
+				const_iterator result{ this, 0 };
+				result.skip_free();
+				return result;
+			}
+
+			iterator end() noexcept
+			{
+				return { this, capacity_ };
+			}
+
+			const_iterator end() const noexcept
+			{
+				return { this, capacity_ };
+			}
+
+			size_t size() const noexcept
+			{
+				return size_;
+			}
+
+			bool empty() const noexcept
+			{
+				return size_ == 0;
+			}
+
+			size_t capacity() const noexcept
+			{
+				return capacity_;
+			}
+
+			// Makes room for count elements without further allocations
+			void reserve(size_t count)
+			{
+				auto capacity = width;
+				while (capacity - capacity / 8 < count)
+					capacity *= 2;
+				if (capacity > capacity_)
+					rehash(capacity);
+			}
+
+			void clear() noexcept
+			{
+				destroy_elements();
+				if (capacity_)
+					std::fill_n(ctrl, capacity_, guid_map_empty);
+				size_ = 0;
+				deleted = 0;
+			}
+
+			iterator find(const GUID &key) noexcept
+			{
+				return { this, find_index(key) };
+			}
+
+			const_iterator find(const GUID &key) const noexcept
+			{
+				return { this, find_index(key) };
+			}
+
+			bool contains(const GUID &key) const noexcept
+			{
+				return find_index(key) != capacity_;
+			}
+
+			// Constructs the value from args if the key is not in the map
+			template<class...Args>
+			std::pair<iterator, bool> try_emplace(const GUID &key, Args &&...args)
+			{
+				if (auto index = find_index(key); index != capacity_)
+					return { { this, index }, false };
+				prepare_insert();
+				return { { this, insert_new(hash_guid(key), key, std::forward<Args>(args)...) }, true };
+			}
+
+			std::pair<iterator, bool> insert(const value_type &value)
+			{
+				return try_emplace(value.first, value.second);
+			}
+
+			template<class M>
+			std::pair<iterator, bool> insert_or_assign(const GUID &key, M &&value)
+			{
+				auto result = try_emplace(key, std::forward<M>(value));
+				if (!result.second)
+					result.first->second = std::forward<M>(value);
+				return result;
+			}
+
+			V &operator [](const GUID &key)
+			{
+				return try_emplace(key).first->second;
+			}
+
+			void erase(const_iterator it) noexcept
+			{
+				slots[it.index].value.~value_type();
+				// A slot in a group with an empty slot does not continue any probe sequence and can be made empty again
+				const auto first = it.index & ~(width - 1);
+				if (guid_map_group{ ctrl + first }.match_empty())
+					ctrl[it.index] = guid_map_empty;
+				else
+				{
+					ctrl[it.index] = guid_map_deleted;
+					++deleted;
+				}
+				--size_;
+			}
+
+			size_t erase(const GUID &key) noexcept
+			{
+				const auto index = find_index(key);
+				if (index == capacity_)
+					return 0;
+				erase(const_iterator{ this, index });
+				return 1;
+			}
+
+			// Number of groups examined by find for a key
+			size_t probe_length(const GUID &key) const noexcept
+			{
+				if (!capacity_)
+					return 0;
+				const auto hash = hash_guid(key);
+				const auto tag = tag_of(hash);
+				size_t count{};
+				probe(hash, [&](size_t first) noexcept
+				{
+					++count;
+					const guid_map_group group{ ctrl + first };
+					for (auto match = group.match(tag); match; match &= match - 1)
+					{
+						if (equal_guids(slots[first + std::countr_zero(match)].value.first, key))
+							return true;
+					}
+					return group.match_empty() != 0;
+				});
+				return count;
+			}
+
+			guid_map_stats get_stats() const noexcept
+			{
+				guid_map_stats result{ size_, capacity_, deleted, 0, 0, 0 };
+				if (!capacity_)
+					return result;
+
+				size_t total{};
+				for (const auto &value : *this)
+				{
+					const auto probes = probe_length(value.first);
+					total += probes;
+					result.max_probes = std::max(result.max_probes, probes);
+				}
+				if (size_)
+					result.average_probes = static_cast<double>(total) / size_;
+
+				// A failed lookup may start at any group with equal probability
+				const auto groups = capacity_ / width;
+				size_t miss_total{};
+				for (size_t group = 0; group != groups; ++group)
+				{
+					probe(group << 7, [&](size_t first) noexcept
+					{
+						++miss_total;
+						return guid_map_group{ ctrl + first }.match_empty() != 0;
+					});
+				}
+				result.average_miss_probes = static_cast<double>(miss_total) / groups;
+				return result;
+			}
+		};
+	}
+
+	using details::guid_map;
+	using details::guid_map_stats;
+}
+
+namespace bcom
+{
+	template<class V>
+	using guid_map = belt::com::guid_map<V>;
+}
@@ -0,0 +1,283 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "platform.h"
+
+// Biased reference counting
+//
+// An object is owned by the thread that takes its first reference. The owner thread updates a plain counter, all other
+// threads update an atomic shared counter. Both counters are merged when the owner releases its last reference, when
+// the owner explicitly hands the object off, or when a non-owner thread takes the shared counter below zero (that is,
+// it has released a reference taken by the owner). In the latter case the object is queued to the owner thread, which
+// merges it on its next Release call on any biased object or when it exits. Once a non-owner thread has marked the object
+// as queued, the owner thread leaves the merge to the queue, so that the object stays alive and unmerged until it is
+// pushed.
+
+namespace belt::com::details
+{
+	struct biased_ref_count_base;
+
+	class biased_owner
+	{
+		std::atomic<int> references{ 1 };
+		std::atomic<biased_ref_count_base *> queue{};
+
+		static biased_ref_count_base *closed() noexcept
+		{
+			return reinterpret_cast<biased_ref_count_base *>(uintptr_t{ 1 });
+		}
+
+		static void merge_list(biased_ref_count_base *list) noexcept;
+
+		// Trivially destructible, so that they can be read while other thread-local objects are destroyed
+		static inline thread_local constinit biased_owner *thread_owner{};
+		static inline thread_local constinit bool thread_exited{};
+
+		struct thread_holder
+		{
+			biased_owner *owner{ new biased_owner };
+
+			thread_holder() noexcept
+			{
+				thread_owner = owner;
+			}
+
+			// Objects released by the merge, or by destructors of thread-local objects that run later, see no owner thread
+			// and use the shared counter
+			~thread_holder()
+			{
+				thread_owner = nullptr;
+				thread_exited = true;
+				merge_list(owner->queue.exchange(closed(), std::memory_order_acq_rel));
+				owner->release();
+			}
+		};
+
+	public:
+		// Returns nullptr once the calling thread has started to exit
+		static biased_owner *current() noexcept
+		{
+			if (auto owner = thread_owner) [[likely]]
+				return owner;
+			if (thread_exited)
+				return nullptr;
+			static thread_local thread_holder holder;
+			return holder.owner;
+		}
+
+		// Marks merged objects
+		static biased_owner *merged() noexcept
+		{
+			return reinterpret_cast<biased_owner *>(uintptr_t{ 1 });
+		}
+
+		void add_ref() noexcept
+		{
+			references.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void release() noexcept
+		{
+			if (references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				delete this;
+		}
+
+		bool has_queued() const noexcept
+		{
+			auto head = queue.load(std::memory_order_relaxed);
+			return head != nullptr && head != closed();
+		}
+
+		// Called by the owner thread only. The queue is closed only by the owner thread, so it cannot be closed concurrently
+		void drain() noexcept
+		{
+			if (has_queued())
+				merge_list(queue.exchange(nullptr, std::memory_order_acquire));
+		}
+
+		// Returns false if the owner thread has already exited
+		bool push(biased_ref_count_base *object) noexcept;
+	};
+
+	struct biased_ref_count_base
+	{
+		static constexpr int64_t merged_flag = 1;
+		static constexpr int64_t queued_flag = 2;
+		static constexpr int64_t count_unit = 4;
+
+		std::atomic<biased_owner *> _rc_owner{};
+		int _rc_biased{};
+		// (count * count_unit) | queued_flag | merged_flag
+		std::atomic<int64_t> _rc_shared{};
+		// Owner thread's merge queue
+		biased_ref_count_base *_rc_next{};
+		IUnknown *_rc_self{};
+
+		// Turns the result of the release operation into a value that is 1 only if the last reference has been released
+		static int64_t _rc_previous(int64_t count) noexcept
+		{
+			return count == 0 ? 1 : std::max<int64_t>(count + 1, 2);
+		}
+
+		// Called by the owner thread for a queued object, or by any thread once the owner thread has exited. Returns resulting
+		// reference count
+		int64_t _rc_merge() noexcept
+		{
+			auto owner = _rc_owner.exchange(biased_owner::merged(), std::memory_order_relaxed);
+			auto biased = std::exchange(_rc_biased, 0);
+			auto prev = _rc_shared.fetch_add(biased * count_unit + merged_flag, std::memory_order_acq_rel);
+			owner->release();
+			return (prev >> 2) + biased;
+		}
+
+		// Called by the owner thread. Returns false and leaves the object biased if a non-owner thread has marked it as queued
+		bool _rc_try_merge(int64_t &count) noexcept
+		{
+			auto shared = _rc_shared.load(std::memory_order_relaxed);
+			do
+			{
+				if (shared & queued_flag)
+					return false;
+			} while (!_rc_shared.compare_exchange_weak(shared, shared + _rc_biased * count_unit + merged_flag, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+			count = (shared >> 2) + std::exchange(_rc_biased, 0);
+			_rc_owner.exchange(biased_owner::merged(), std::memory_order_relaxed)->release();
+			return true;
+		}
+
+		int64_t _rc_fetch_add() noexcept
+		{
+			if (auto self = biased_owner::current()) [[likely]]
+			{
+				auto owner = _rc_owner.load(std::memory_order_relaxed);
+				if (owner == self)
+					return _rc_biased++;
+				else if (owner == nullptr && _rc_owner.compare_exchange_strong(owner, self, std::memory_order_relaxed))
+				{
+					self->add_ref();
+					return _rc_biased++;
+				}
+			}
+			return _rc_shared.fetch_add(count_unit, std::memory_order_relaxed) >> 2;
+		}
+
+		int64_t _rc_fetch_sub(IUnknown *self_unknown) noexcept
+		{
+			auto self = biased_owner::current();
+			// The caller holds a reference, so draining the queue cannot destroy this object, but it may merge it
+			if (self && self->has_queued())
+				self->drain();
+
+			auto owner = _rc_owner.load(std::memory_order_relaxed);
+			if (self && owner == self)
+			{
+				int64_t count;
+				if (--_rc_biased != 0)
+					return _rc_biased + 1;
+				else if (_rc_try_merge(count))
+					return _rc_previous(count);
+				else
+					// The queued object is merged, and destroyed if this was the last reference, by the next drain
+					return 2;
+			}
+
+			auto prev = _rc_shared.fetch_sub(count_unit, std::memory_order_acq_rel);
+			auto count = (prev >> 2) - 1;
+			if (!(prev & merged_flag) && count < 0 && !(prev & queued_flag))
+			{
+				// The owner thread may have merged the object after the decrement, the merge has then accounted for it
+				auto flags = _rc_shared.fetch_or(queued_flag, std::memory_order_acq_rel);
+				if (!(flags & (merged_flag | queued_flag)))
+				{
+					// This thread has released a reference taken by the owner thread. The object is not merged before it is
+					// pushed, so its owner is still alive. The owner is pinned for the push, as the owner thread may merge the
+					// object, which releases its reference to the owner, as soon as it is in the queue
+					owner = _rc_owner.load(std::memory_order_relaxed);
+					owner->add_ref();
+					_rc_self = self_unknown;
+					const bool pushed = owner->push(this);
+					owner->release();
+					if (!pushed)
+						return _rc_previous(_rc_merge());
+				}
+			}
+
+			if (prev & merged_flag)
+				return _rc_previous(count);
+			else
+				return std::max<int64_t>(count + 1, 2);
+		}
+
+		void _rc_store(int64_t value) noexcept
+		{
+			_rc_shared.store(value * count_unit | merged_flag, std::memory_order_relaxed);
+		}
+
+		// Called by the owner thread before the object is handed to other threads
+		void _rc_hand_off() noexcept
+		{
+			auto self = biased_owner::current();
+			if (!self)
+				return;
+			self->drain();
+			// A queued object stays biased until the next drain
+			int64_t count;
+			if (_rc_owner.load(std::memory_order_relaxed) == self)
+				_rc_try_merge(count);
+		}
+
+		void safe_increment() noexcept
+		{
+			_rc_shared.fetch_add(10 * count_unit, std::memory_order_relaxed);
+		}
+
+		void safe_decrement() noexcept
+		{
+			_rc_shared.fetch_sub(10 * count_unit, std::memory_order_relaxed);
+		}
+	};
+
+	inline bool biased_owner::push(biased_ref_count_base *object) noexcept
+	{
+		auto head = queue.load(std::memory_order_acquire);
+		do
+		{
+			if (head == closed())
+				return false;
+			object->_rc_next = head;
+		} while (!queue.compare_exchange_weak(head, object, std::memory_order_acq_rel, std::memory_order_acquire));
+		return true;
+	}
+
+	inline void biased_owner::merge_list(biased_ref_count_base *list) noexcept
+	{
+		while (list)
+		{
+			auto next = list->_rc_next;
+			auto self = list->_rc_self;
+			// Only objects marked as queued are pushed, and the owner thread does not merge those, so this is a safeguard
+			if (list->_rc_owner.load(std::memory_order_relaxed) == merged())
+			{
+				list = next;
+				continue;
+			}
+			// Temporary reference makes sure the object is released through its own Release method
+			++list->_rc_biased;
+			list->_rc_merge();
+			self->Release();
+			list = next;
+		}
+	}
+}
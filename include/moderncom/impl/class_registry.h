@@ -0,0 +1,161 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "platform.h"
+#include "../guid_map.h"
+
+// Registry of classes available for default construction
+//
+// Classes register themselves by placing a pointer to their entry into a dedicated linker section. The entries of a module
+// are collected on first use into a guid_map, which is never modified afterwards and is read without synchronization. Each
+// module has its own registry.
+
+namespace belt::com::details
+{
+	using create_function_t = HRESULT(*)(const GUID &iid, void **ppv, IUnknown *) noexcept;
+	struct _OBJMAP_ENTRY
+	{
+		GUID clsid;
+		create_function_t create;
+	};
+
+	using registered_class = _OBJMAP_ENTRY;
+
+#if defined(_MSC_VER)
+#pragma section("BIS$__a", read)
+#pragma section("BIS$__z", read)
+#pragma section("BIS$__b", read)
+	extern "C"
+	{
+		__declspec(selectany) __declspec(allocate("BIS$__a")) _OBJMAP_ENTRY* __pobjObjEntryFirst = nullptr;
+		__declspec(selectany) __declspec(allocate("BIS$__z")) _OBJMAP_ENTRY* __pobjObjEntryLast = nullptr;
+	}
+
+	inline const _OBJMAP_ENTRY *const *objmap_begin() noexcept
+	{
+		return &__pobjObjEntryFirst + 1;
+	}
+
+	inline const _OBJMAP_ENTRY *const *objmap_end() noexcept
+	{
+		return &__pobjObjEntryLast;
+	}
+#else
+	// The linker provides start and stop symbols for a section named as a C identifier.
+	// Declared weak so that a module without registered classes still links
+	extern "C"
+	{
+		extern const _OBJMAP_ENTRY *const __start_belt_objmap[] __attribute__((weak, visibility("hidden")));
+		extern const _OBJMAP_ENTRY *const __stop_belt_objmap[] __attribute__((weak, visibility("hidden")));
+	}
+
+	inline const _OBJMAP_ENTRY *const *objmap_begin() noexcept
+	{
+		return __start_belt_objmap;
+	}
+
+	inline const _OBJMAP_ENTRY *const *objmap_end() noexcept
+	{
+		return __stop_belt_objmap;
+	}
+#endif
+
+	struct class_registry_stats
+	{
+		// Number of distinct registered CLSIDs
+		size_t classes;
+		// Number of entries ignored because their CLSID was already registered
+		size_t duplicates;
+		// Number of hash table slots
+		size_t capacity;
+		// Average and maximum number of groups of 16 slots examined to find a registered class
+		double average_probes;
+		size_t max_probes;
+		// Average number of groups of 16 slots examined to find out that a class is not registered
+		double average_miss_probes;
+	};
+
+	class class_registry
+	{
+		std::vector<registered_class> classes;
+		// Position of each class in classes
+		guid_map<size_t> positions;
+		size_t duplicates{};
+
+	public:
+		// Registration order is preserved, the first entry wins if a CLSID is registered several times
+		class_registry(const _OBJMAP_ENTRY *const *begin, const _OBJMAP_ENTRY *const *end)
+		{
+			classes.reserve(end - begin);
+			positions.reserve(end - begin);
+
+			for (auto p = begin; p < end; ++p)
+			{
+				if (!*p)
+					continue;
+				if (positions.try_emplace((*p)->clsid, classes.size()).second)
+					classes.push_back(**p);
+				else
+					++duplicates;
+			}
+		}
+
+		const registered_class *find(const GUID &clsid) const noexcept
+		{
+			auto it = positions.find(clsid);
+			return it != positions.end() ? &classes[it->second] : nullptr;
+		}
+
+		// Number of classes and the position of a class returned by find, for tables that keep additional data per class
+		size_t size() const noexcept
+		{
+			return classes.size();
+		}
+
+		size_t index_of(const registered_class *entry) const noexcept
+		{
+			return static_cast<size_t>(entry - classes.data());
+		}
+
+		std::span<const registered_class> get_classes() const noexcept
+		{
+			return classes;
+		}
+
+		class_registry_stats get_stats() const noexcept
+		{
+			const auto stats = positions.get_stats();
+			return { classes.size(), duplicates, stats.capacity, stats.average_probes, stats.max_probes, stats.average_miss_probes };
+		}
+	};
+
+	// Built on first use and never destroyed, so that objects can still be created during static destruction. Module-local,
+	// as each module has its own set of registered classes
+	BELT_MODULE_LOCAL inline const class_registry &get_class_registry()
+	{
+		static const auto *registry = new class_registry{ objmap_begin(), objmap_end() };
+		return *registry;
+	}
+
+	// Registered classes of the current module in registration order
+	BELT_MODULE_LOCAL inline std::span<const registered_class> get_registered_classes()
+	{
+		return get_class_registry().get_classes();
+	}
+
+	BELT_MODULE_LOCAL inline class_registry_stats get_class_registry_stats()
+	{
+		return get_class_registry().get_stats();
+	}
+}
@@ -0,0 +1,136 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <utility>
+
+#include "platform.h"
+
+#if defined(_WIN32)
+#include <cstdint>
+#include <string>
+#endif
+
+// Leak detection cookie channel
+//
+// com_ptr passes the cookie of a reference to the object's AddRef and Release (and back) through a per-thread cell. com_ptr
+// and the object may live in different modules, so all modules in the process must use the same cell. On Windows, the
+// first module that needs the channel allocates a TLS slot and publishes its index through a named section. The slot is
+// never freed, so it outlives every module. Elsewhere, the first module publishes the cell of its own module through the
+// only symbol exported by the library, belt_com_cookie_channel, and each module caches the address of the cell in its own
+// thread-local pointer.
+
+namespace belt::com::details
+{
+	struct cookie_channel
+	{
+		int *(*cell)() noexcept;
+	};
+
+	BELT_MODULE_LOCAL inline constinit thread_local int module_cookie{};
+
+	inline int *module_cookie_cell() noexcept
+	{
+		return &module_cookie;
+	}
+}
+
+#if !defined(_WIN32)
+// An executable that exports it with -Wl,--export-dynamic-symbol=belt_com_cookie_channel provides the definition used by all
+// shared libraries. Otherwise, GCC gives it unique binding (STB_GNU_UNIQUE), so that all shared libraries, including those
+// loaded with RTLD_LOCAL, share the first loaded definition, and the library that provides it is never unloaded. Clang does
+// not emit unique symbols: libraries loaded with RTLD_LOCAL then use their own definition
+extern "C"
+{
+	BELT_EXPORTED inline constinit belt::com::details::cookie_channel belt_com_cookie_channel{ &belt::com::details::module_cookie_cell };
+}
+#endif
+
+namespace belt::com::details
+{
+#if defined(_WIN32)
+	// Returns TLS_OUT_OF_INDEXES if the slot cannot be published, the module then uses its own cell
+	inline DWORD find_cookie_slot() noexcept
+	{
+		using namespace std::literals;
+
+		// Earlier versions of the library stored a TLS index in BELT_LEAK_DETECTION_SECTION, and a later one a pointer to
+		// module data. The name carries the version of the contents, so that modules built with different versions do not
+		// misinterpret each other's value. The section and its view are intentionally never closed
+		HANDLE section = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(LONG), (L"BELT_COM_COOKIE_SLOT.2."s + std::to_wstring(GetCurrentProcessId())).c_str());
+		if (!section)
+			return TLS_OUT_OF_INDEXES;
+		auto published = static_cast<volatile LONG *>(MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, sizeof(LONG)));
+		if (!published)
+			return TLS_OUT_OF_INDEXES;
+
+		// The index is published plus one, so that zero means that no module has published it yet
+		if (auto value = *published)
+			return static_cast<DWORD>(value - 1);
+		const auto slot = TlsAlloc();
+		if (slot == TLS_OUT_OF_INDEXES)
+			return slot;
+		if (auto previous = InterlockedCompareExchange(published, static_cast<LONG>(slot + 1), 0))
+		{
+			TlsFree(slot);
+			return static_cast<DWORD>(previous - 1);
+		}
+		return slot;
+	}
+
+	inline DWORD get_cookie_slot() noexcept
+	{
+		static const DWORD slot = find_cookie_slot();
+		return slot;
+	}
+
+	inline void set_current_cookie(int cookie) noexcept
+	{
+		if (const auto slot = get_cookie_slot(); slot != TLS_OUT_OF_INDEXES) [[likely]]
+			TlsSetValue(slot, reinterpret_cast<void *>(static_cast<intptr_t>(cookie)));
+		else
+			module_cookie = cookie;
+	}
+
+	inline int get_current_cookie() noexcept
+	{
+		if (const auto slot = get_cookie_slot(); slot != TLS_OUT_OF_INDEXES) [[likely]]
+		{
+			auto value = TlsGetValue(slot);
+			TlsSetValue(slot, nullptr);
+			return static_cast<int>(reinterpret_cast<intptr_t>(value));
+		}
+		return std::exchange(module_cookie, 0);
+	}
+#else
+	inline const cookie_channel &get_cookie_channel() noexcept
+	{
+		return belt_com_cookie_channel;
+	}
+
+	BELT_MODULE_LOCAL inline constinit thread_local int *current_cookie{};
+
+	inline int &current_cookie_cell() noexcept
+	{
+		if (!current_cookie) [[unlikely]]
+			current_cookie = get_cookie_channel().cell();
+		return *current_cookie;
+	}
+
+	inline void set_current_cookie(int cookie) noexcept
+	{
+		current_cookie_cell() = cookie;
+	}
+
+	inline int get_current_cookie() noexcept
+	{
+		return std::exchange(current_cookie_cell(), 0);
+	}
+#endif
+}
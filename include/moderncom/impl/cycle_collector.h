@@ -0,0 +1,430 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../com_ptr.h"
+#include "srwlock.h"
+#include "onexit.h"
+
+// Cycle collector
+//
+// Objects of classes with collects_cycles trait are kept in a per-module list and report the com_ptr members they own
+// through their traverse method. The collector adds a reference to every listed object, takes a snapshot of reference counts
+// and ownership edges, and subtracts the references held by listed objects from the reference counts (trial deletion).
+// Objects not reachable from an object that still has other references are garbage: they are referenced only by each other.
+// The collector repeats the snapshot and checks the objects' mutation epochs to make sure the graph has not changed, clears
+// the members of garbage objects and releases its own references, which destroys them. Two equal snapshots alone do not
+// prove that: a mutator may move a reference between an object that has not been visited and one that has been during each
+// of them. Objects bump their epoch whenever they change their members, so such a move is seen as a change.
+
+namespace belt::com::details
+{
+	class cycle_visitor;
+	struct cycle_node;
+
+	// Operations on tracked objects of a class
+	struct cycle_class
+	{
+		std::string_view name;
+		size_t size;
+		// Adds a reference unless the object's reference count has dropped to zero
+		bool (*pin)(cycle_node *) noexcept;
+		// Removes the reference added by pin and destroys the object if it was the last one
+		void (*unpin)(cycle_node *) noexcept;
+		size_t (*count)(const cycle_node *) noexcept;
+		void (*traverse)(cycle_node *, cycle_visitor &);
+		// The object's IUnknown, the same pointer its QueryInterface returns for IUnknown
+		IUnknown *(*identity)(cycle_node *) noexcept;
+	};
+
+	// Member names are prefixed to avoid clashes with names declared in Derived
+	struct cycle_node
+	{
+		cycle_node *_cc_prev{};
+		cycle_node *_cc_next{};
+		const cycle_class *_cc_type{};
+		// Incremented by the object whenever it changes the members it reports to traverse
+		std::atomic<uint64_t> _cc_epoch{};
+
+		cycle_node() noexcept = default;
+
+		// A copy is a different object and is tracked separately
+		cycle_node(const cycle_node &) noexcept
+		{
+		}
+
+		cycle_node &operator =(const cycle_node &) = delete;
+	};
+
+	struct no_cycle_node {};
+
+	class cycle_registry
+	{
+		srwlock lock;
+		// Head of the circular list of tracked objects
+		cycle_node head;
+		size_t size{};
+
+	public:
+		// Serializes collections
+		std::mutex collector_lock;
+
+		cycle_registry() noexcept
+		{
+			head._cc_prev = head._cc_next = &head;
+		}
+
+		void track(cycle_node *node, const cycle_class *type) noexcept
+		{
+			node->_cc_type = type;
+			std::scoped_lock l{ lock };
+			node->_cc_prev = head._cc_prev;
+			node->_cc_next = &head;
+			head._cc_prev->_cc_next = node;
+			head._cc_prev = node;
+			++size;
+		}
+
+		// May be called more than once by the thread that destroys the object
+		void untrack(cycle_node *node) noexcept
+		{
+			if (!node->_cc_type)
+				return;
+			std::scoped_lock l{ lock };
+			node->_cc_prev->_cc_next = node->_cc_next;
+			node->_cc_next->_cc_prev = node->_cc_prev;
+			node->_cc_prev = node->_cc_next = nullptr;
+			node->_cc_type = nullptr;
+			--size;
+		}
+
+		// Adds a reference to every tracked object whose reference count has not yet dropped to zero
+		std::vector<cycle_node *> pin_all()
+		{
+			std::vector<cycle_node *> result;
+			std::shared_lock l{ lock };
+			result.reserve(size);
+			for (auto node = head._cc_next; node != &head; node = node->_cc_next)
+			{
+				if (node->_cc_type->pin(node))
+					result.push_back(node);
+			}
+			return result;
+		}
+	};
+
+	// Built on first use and never destroyed, so that objects can still be released during static destruction. Module-local,
+	// as tracked objects refer to functions of the module that created them
+	BELT_MODULE_LOCAL inline cycle_registry &get_cycle_registry()
+	{
+		static auto *registry = new cycle_registry;
+		return *registry;
+	}
+
+	// Passed to traverse method of a tracked object, which must call it for each com_ptr member it owns. traverse may be called
+	// concurrently with other methods and must synchronize access to the members the same way they do
+	class cycle_visitor
+	{
+		// Snapshot: indices of the tracked objects referenced by members, found by their identity
+		std::vector<size_t> *edges{};
+		const std::unordered_map<IUnknown *, size_t> *indices{};
+		// Clearing: pointers taken from members, released after all garbage objects are cleared
+		std::vector<IUnknown *> *released{};
+
+		friend class cycle_collector;
+
+		cycle_visitor(std::vector<size_t> &edges, const std::unordered_map<IUnknown *, size_t> &indices) noexcept :
+			edges{ &edges },
+			indices{ &indices }
+		{}
+
+		explicit cycle_visitor(std::vector<IUnknown *> &released) noexcept :
+			released{ &released }
+		{}
+
+	public:
+		cycle_visitor(const cycle_visitor &) = delete;
+		cycle_visitor &operator =(const cycle_visitor &) = delete;
+
+		template<class Interface>
+		void operator()(com_ptr<Interface> &member)
+		{
+			if (!member)
+				return;
+
+			if (edges)
+			{
+				// Objects that are not tracked, or were created after the collection started, are not part of the graph. The
+				// reference added by QueryInterface is released before the object's reference count is read
+				if (auto identity = member.template as<IUnknown>())
+				{
+					if (auto it = indices->find(identity.get()); it != indices->end())
+						edges->push_back(it->second);
+				}
+			}
+			else
+			{
+				released->push_back(member.get());
+				static_cast<void>(member.detach());
+			}
+		}
+	};
+
+	struct cycle_class_stats
+	{
+		std::string_view class_name;
+		size_t objects;
+		size_t bytes;
+	};
+
+	struct cycle_collection
+	{
+		// Number of tracked objects examined
+		size_t scanned{};
+		// Number and total size of destroyed objects
+		size_t objects{};
+		size_t bytes{};
+		// Set if reference counts or members changed while the collector was taking the snapshots. Nothing is collected then
+		bool graph_changed{};
+		// Destroyed objects per class, largest total size first
+		std::vector<cycle_class_stats> classes;
+	};
+
+	class cycle_collector
+	{
+		struct snapshot
+		{
+			std::vector<size_t> counts;
+			// Edges of object i are edges[edge_begin[i]] to edges[edge_begin[i + 1]]
+			std::vector<size_t> edge_begin;
+			std::vector<size_t> edges;
+
+			bool operator ==(const snapshot &) const = default;
+		};
+
+		std::vector<cycle_node *> nodes;
+		std::unordered_map<IUnknown *, size_t> indices;
+
+		// An object bumps its epoch in the same critical section as the change of its members, so the epochs read after
+		// the last snapshot include every change the snapshots could have missed
+		std::vector<uint64_t> read_epochs() const
+		{
+			std::vector<uint64_t> result;
+			result.reserve(nodes.size());
+			for (auto node : nodes)
+				result.push_back(node->_cc_epoch.load(std::memory_order_acquire));
+			return result;
+		}
+
+		snapshot take_snapshot() const
+		{
+			snapshot result;
+			result.counts.reserve(nodes.size());
+			result.edge_begin.reserve(nodes.size() + 1);
+			cycle_visitor visitor{ result.edges, indices };
+			for (auto node : nodes)
+			{
+				result.counts.push_back(node->_cc_type->count(node));
+				result.edge_begin.push_back(result.edges.size());
+				node->_cc_type->traverse(node, visitor);
+			}
+			result.edge_begin.push_back(result.edges.size());
+			return result;
+		}
+
+		// Returns the garbage flag for each object, or an empty vector if the snapshot is inconsistent
+		static std::vector<char> find_garbage(const snapshot &graph)
+		{
+			const auto count = graph.counts.size();
+
+			// References other than the collector's own and those held by tracked objects
+			std::vector<int64_t> external(count);
+			for (size_t i = 0; i != count; ++i)
+				external[i] = static_cast<int64_t>(graph.counts[i]) - 1;
+			for (auto target : graph.edges)
+				--external[target];
+
+			std::vector<char> garbage(count, 1);
+			std::vector<size_t> pending;
+			for (size_t i = 0; i != count; ++i)
+			{
+				if (external[i] < 0)
+					return {};
+				if (external[i] > 0)
+				{
+					garbage[i] = 0;
+					pending.push_back(i);
+				}
+			}
+
+			while (!pending.empty())
+			{
+				auto i = pending.back();
+				pending.pop_back();
+				for (auto e = graph.edge_begin[i]; e != graph.edge_begin[i + 1]; ++e)
+				{
+					if (auto target = graph.edges[e]; garbage[target])
+					{
+						garbage[target] = 0;
+						pending.push_back(target);
+					}
+				}
+			}
+			return garbage;
+		}
+
+		// Garbage objects are referenced only by each other and by the collector and cannot change any more. Their members are
+		// released after all of them are cleared, the objects are destroyed when the collector removes its references
+		void clear(const std::vector<char> &garbage, cycle_collection &result) const
+		{
+			std::vector<IUnknown *> released;
+			SCOPE_EXIT
+			{
+				for (auto p : released)
+					p->Release();
+			};
+
+			cycle_visitor visitor{ released };
+			for (size_t i = 0; i != nodes.size(); ++i)
+			{
+				if (!garbage[i])
+					continue;
+				const auto type = nodes[i]->_cc_type;
+				type->traverse(nodes[i], visitor);
+
+				++result.objects;
+				result.bytes += type->size;
+				auto stats = std::find_if(result.classes.begin(), result.classes.end(), [&](const cycle_class_stats &s) { return s.class_name == type->name; });
+				if (stats == result.classes.end())
+					result.classes.push_back({ type->name, 1, type->size });
+				else
+				{
+					++stats->objects;
+					stats->bytes += type->size;
+				}
+			}
+			std::sort(result.classes.begin(), result.classes.end(), [](const cycle_class_stats &a, const cycle_class_stats &b) { return a.bytes > b.bytes; });
+		}
+
+	public:
+		cycle_collection collect()
+		{
+			cycle_collection result;
+
+			nodes = get_cycle_registry().pin_all();
+			SCOPE_EXIT
+			{
+				for (auto node : nodes)
+					node->_cc_type->unpin(node);
+			};
+			indices.reserve(nodes.size());
+			for (size_t i = 0; i != nodes.size(); ++i)
+				indices.emplace(nodes[i]->_cc_type->identity(nodes[i]), i);
+			result.scanned = nodes.size();
+
+			const auto epochs = read_epochs();
+			const auto graph = take_snapshot();
+			const auto garbage = find_garbage(graph);
+			if (garbage.empty() && !nodes.empty())
+			{
+				result.graph_changed = true;
+				return result;
+			}
+			if (std::find(garbage.begin(), garbage.end(), 1) == garbage.end())
+				return result;
+			if (take_snapshot() != graph || read_epochs() != epochs)
+			{
+				result.graph_changed = true;
+				return result;
+			}
+
+			clear(garbage, result);
+			return result;
+		}
+	};
+
+	// Finds and destroys garbage cycles of tracked objects of the current module. Runs one collection at a time. Must not be
+	// called from destructors or final_release of tracked objects
+	BELT_MODULE_LOCAL inline cycle_collection collect_cycles()
+	{
+		std::scoped_lock l{ get_cycle_registry().collector_lock };
+		return cycle_collector{}.collect();
+	}
+
+	// Background thread that collects cycles periodically and on request, stopped and joined by the destructor
+	class cycle_collector_thread
+	{
+	public:
+		using callback_t = std::function<void(const cycle_collection &)>;
+
+	private:
+		std::mutex lock;
+		std::condition_variable_any wake;
+		bool requested{};
+		std::jthread thread;
+
+		void run(std::stop_token stop, std::chrono::milliseconds interval, const callback_t &on_collected)
+		{
+			std::unique_lock l{ lock };
+			while (!stop.stop_requested())
+			{
+				wake.wait_for(l, stop, interval, [this] { return requested; });
+				if (stop.stop_requested())
+					break;
+				requested = false;
+
+				l.unlock();
+				try
+				{
+					auto result = collect_cycles();
+					if (on_collected)
+						on_collected(result);
+				}
+				catch (...)
+				{
+					// Out of memory, the next collection will try again
+				}
+				l.lock();
+			}
+		}
+
+	public:
+		explicit cycle_collector_thread(std::chrono::milliseconds interval, callback_t on_collected = {}) :
+			thread{ [this, interval, on_collected = std::move(on_collected)](std::stop_token stop) { run(stop, interval, on_collected); } }
+		{}
+
+		cycle_collector_thread(const cycle_collector_thread &) = delete;
+		cycle_collector_thread &operator =(const cycle_collector_thread &) = delete;
+
+		// Starts a collection without waiting for the interval to elapse
+		void request() noexcept
+		{
+			{
+				std::scoped_lock l{ lock };
+				requested = true;
+			}
+			wake.notify_one();
+		}
+	};
+}
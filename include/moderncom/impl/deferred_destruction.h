@@ -0,0 +1,268 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+
+#include "platform.h"
+
+// Deferred destruction
+//
+// When the reference count of an object of a class with deferred_destruction trait drops to zero, the releasing thread
+// pushes the object onto a lock-free stack instead of running final_release. The stack is taken as a whole by a reclaimer
+// thread or by an explicit drain call, which destroys the objects in the order they were released. If too many objects are
+// queued, the releasing thread destroys the object itself.
+
+namespace belt::com::details
+{
+	// Member names are prefixed to avoid clashes with names declared in Derived
+	struct deferred_node
+	{
+		deferred_node *_dd_next{};
+		void (*_dd_destroy)(deferred_node *) noexcept {};
+		// steady_clock time of the release
+		int64_t _dd_released{};
+
+		deferred_node() noexcept = default;
+
+		deferred_node(const deferred_node &) noexcept
+		{
+		}
+
+		deferred_node &operator =(const deferred_node &) = delete;
+	};
+
+	struct no_deferred_node {};
+
+	struct deferred_stats
+	{
+		// Objects queued and not yet destroyed, and the maximum of that number
+		size_t depth;
+		size_t max_depth;
+		// Objects destroyed by drain calls
+		uint64_t reclaimed;
+		// Objects destroyed by releasing threads because the queue was full
+		uint64_t destroyed_inline;
+		// Time from the release of an object to its destruction by drain
+		std::chrono::nanoseconds average_latency;
+		std::chrono::nanoseconds max_latency;
+	};
+
+	class reclaimer
+	{
+		std::atomic<deferred_node *> queue{};
+		// Incremented when the queue becomes non-empty, waited on by reclaimer threads
+		std::atomic<uint32_t> wake{};
+
+		std::atomic<size_t> depth{};
+		std::atomic<size_t> max_depth{};
+		std::atomic<size_t> capacity{ 65536 };
+		std::atomic<uint64_t> reclaimed{};
+		std::atomic<uint64_t> destroyed_inline{};
+		std::atomic<int64_t> total_latency{};
+		std::atomic<int64_t> max_latency{};
+
+		// Objects are destroyed by one thread at a time
+		std::mutex drain_lock;
+
+		static int64_t now() noexcept
+		{
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+		}
+
+		template<class T>
+		static void update_max(std::atomic<T> &max, T value) noexcept
+		{
+			auto current = max.load(std::memory_order_relaxed);
+			while (current < value && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+				;
+		}
+
+		// Destroys a list taken from the queue, oldest object first
+		size_t destroy_list(deferred_node *list) noexcept
+		{
+			deferred_node *reversed{};
+			size_t count{};
+			while (list)
+			{
+				auto next = list->_dd_next;
+				list->_dd_next = reversed;
+				reversed = list;
+				list = next;
+				++count;
+			}
+			depth.fetch_sub(count, std::memory_order_relaxed);
+
+			int64_t latency{}, longest{};
+			while (reversed)
+			{
+				auto next = reversed->_dd_next;
+				auto released = reversed->_dd_released;
+				reversed->_dd_destroy(reversed);
+				auto elapsed = now() - released;
+				latency += elapsed;
+				longest = std::max(longest, elapsed);
+				reversed = next;
+			}
+
+			reclaimed.fetch_add(count, std::memory_order_relaxed);
+			total_latency.fetch_add(latency, std::memory_order_relaxed);
+			update_max(max_latency, longest);
+			return count;
+		}
+
+	public:
+		void push(deferred_node *node, void (*destroy)(deferred_node *) noexcept) noexcept
+		{
+			auto queued = depth.fetch_add(1, std::memory_order_relaxed) + 1;
+			if (queued > capacity.load(std::memory_order_relaxed))
+			{
+				depth.fetch_sub(1, std::memory_order_relaxed);
+				destroyed_inline.fetch_add(1, std::memory_order_relaxed);
+				destroy(node);
+				return;
+			}
+			update_max(max_depth, queued);
+
+			node->_dd_destroy = destroy;
+			node->_dd_released = now();
+			auto head = queue.load(std::memory_order_relaxed);
+			do
+			{
+				node->_dd_next = head;
+			} while (!queue.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+
+			if (!head)
+			{
+				wake.fetch_add(1, std::memory_order_release);
+				wake.notify_all();
+			}
+		}
+
+		// Destroys queued objects, including those released while they are being destroyed. Returns the number of destroyed
+		// objects. Does nothing if called from a destructor run by drain
+		size_t drain() noexcept
+		{
+			static thread_local bool draining{};
+			if (draining)
+				return 0;
+
+			std::scoped_lock l{ drain_lock };
+			draining = true;
+			size_t count{};
+			while (auto list = queue.exchange(nullptr, std::memory_order_acquire))
+				count += destroy_list(list);
+			draining = false;
+			return count;
+		}
+
+		bool empty() const noexcept
+		{
+			return queue.load(std::memory_order_relaxed) == nullptr;
+		}
+
+		uint32_t wake_sequence() const noexcept
+		{
+			return wake.load(std::memory_order_acquire);
+		}
+
+		void wait(uint32_t sequence) const noexcept
+		{
+			wake.wait(sequence, std::memory_order_acquire);
+		}
+
+		void wake_all() noexcept
+		{
+			wake.fetch_add(1, std::memory_order_release);
+			wake.notify_all();
+		}
+
+		// Maximum number of queued objects. A thread that releases an object when the queue is full destroys it itself
+		void set_capacity(size_t value) noexcept
+		{
+			capacity.store(value, std::memory_order_relaxed);
+		}
+
+		deferred_stats get_stats() const noexcept
+		{
+			using std::chrono::duration_cast;
+			using std::chrono::nanoseconds;
+			using std::chrono::steady_clock;
+
+			const auto count = reclaimed.load(std::memory_order_relaxed);
+			const auto total = total_latency.load(std::memory_order_relaxed);
+			return {
+				depth.load(std::memory_order_relaxed),
+				max_depth.load(std::memory_order_relaxed),
+				count,
+				destroyed_inline.load(std::memory_order_relaxed),
+				duration_cast<nanoseconds>(steady_clock::duration{ count ? total / static_cast<int64_t>(count) : 0 }),
+				duration_cast<nanoseconds>(steady_clock::duration{ max_latency.load(std::memory_order_relaxed) }),
+			};
+		}
+	};
+
+	// Never destroyed, so that objects can still be released during static destruction. Module-local, as queued objects refer to
+	// functions of the module that created them. Objects still queued when the module is unloaded are leaked
+	BELT_MODULE_LOCAL inline reclaimer &get_reclaimer()
+	{
+		static auto *instance = new reclaimer;
+		return *instance;
+	}
+
+	BELT_MODULE_LOCAL inline size_t drain_deferred() noexcept
+	{
+		return get_reclaimer().drain();
+	}
+
+	BELT_MODULE_LOCAL inline void set_deferred_capacity(size_t capacity) noexcept
+	{
+		get_reclaimer().set_capacity(capacity);
+	}
+
+	BELT_MODULE_LOCAL inline deferred_stats get_deferred_stats() noexcept
+	{
+		return get_reclaimer().get_stats();
+	}
+
+	// Thread that destroys objects as soon as they are queued. The destructor stops the thread and destroys the remaining objects
+	class reclaimer_thread
+	{
+		std::jthread thread;
+
+		static void run(std::stop_token stop) noexcept
+		{
+			auto &instance = get_reclaimer();
+			std::stop_callback wake_on_stop{ stop, [&instance]() noexcept { instance.wake_all(); } };
+			while (!stop.stop_requested())
+			{
+				auto sequence = instance.wake_sequence();
+				instance.drain();
+				if (instance.empty() && !stop.stop_requested())
+					instance.wait(sequence);
+			}
+			instance.drain();
+		}
+
+	public:
+		reclaimer_thread() :
+			thread{ run }
+		{}
+
+		reclaimer_thread(const reclaimer_thread &) = delete;
+		reclaimer_thread &operator =(const reclaimer_thread &) = delete;
+	};
+}
@@ -9,6 +9,12 @@
 
 #pragma once
 
+#include "platform.h"
+
+#if !defined(_WIN32)
+#include <cerrno>
+#endif
+
 namespace corsl
 {
 	namespace details
@@ -50,7 +56,11 @@ namespace corsl
 
 		[[noreturn]] inline void throw_last_error()
 		{
+#if defined(_WIN32)
 			throw_win32_error(GetLastError());
+#else
+			throw_win32_error(static_cast<DWORD>(errno));
+#endif
 		}
 
 		inline void check_hresult(HRESULT error)
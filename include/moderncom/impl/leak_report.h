@@ -0,0 +1,247 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../com_ptr.h"
+#include "leak_table.h"
+
+#if BELT_HAS_LEAK_SAMPLING
+#include "leak_sampling.h"
+#endif
+
+// Reports of outstanding references, aggregated by class and AddRef call stack
+//
+// JSON reports contain symbolized stacks and can be compared between runs or program phases. pprof reports use the legacy
+// text heap profile format: a line per stack with raw return addresses, followed by the process memory map, so that pprof
+// can symbolize them against the binaries (for example, pprof -base before.heap program after.heap).
+
+namespace belt::com::details
+{
+	struct leak_report_entry
+	{
+		std::string_view class_name;
+		// Call stack of AddRef calls, stack->symbolize() returns a printable stack trace
+		const stack_entry *stack;
+		// Number of outstanding references (sampled references if leak sampling is enabled)
+		size_t count;
+		// Smallest and largest ordinal of these references, larger ordinals were added later
+		int first_ordinal;
+		int last_ordinal;
+	};
+
+	enum class leak_report_format
+	{
+		json,
+		pprof,
+	};
+
+	// Outstanding references grouped by class and call stack, most frequent first
+	inline std::vector<leak_report_entry> get_leak_report()
+	{
+		std::map<std::pair<std::string_view, const stack_entry *>, leak_report_entry> groups;
+		get_leak_table().for_each([&](const leak_detection &record)
+		{
+			auto &entry = groups.try_emplace({ record.class_name, record.stack }, leak_report_entry{ record.class_name, record.stack, 0, record.ordinal, record.ordinal }).first->second;
+			++entry.count;
+			entry.first_ordinal = std::min(entry.first_ordinal, record.ordinal);
+			entry.last_ordinal = std::max(entry.last_ordinal, record.ordinal);
+		});
+
+		std::vector<leak_report_entry> result;
+		result.reserve(groups.size());
+		for (const auto &[key, entry] : groups)
+			result.push_back(entry);
+		std::sort(result.begin(), result.end(), [](const auto &a, const auto &b)
+		{
+			return a.count != b.count ? a.count > b.count : a.first_ordinal < b.first_ordinal;
+		});
+		return result;
+	}
+
+	namespace report
+	{
+		// Number of references each reported reference stands for
+		inline unsigned scale() noexcept
+		{
+#if BELT_HAS_LEAK_SAMPLING
+			return std::max(get_leak_sampling_rate(), 1u);
+#else
+			return 1;
+#endif
+		}
+
+		inline void write_address(std::ostream &os, const void *address)
+		{
+			char buffer[2 + 2 * sizeof(void *) + 1];
+			std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(address)));
+			os << buffer;
+		}
+
+		inline void write_string(std::ostream &os, std::string_view value)
+		{
+			os << '"';
+			for (const char c : value)
+			{
+				switch (c)
+				{
+				case '"':
+					os << "\\\"";
+					break;
+				case '\\':
+					os << "\\\\";
+					break;
+				case '\n':
+					os << "\\n";
+					break;
+				case '\t':
+					os << "\\t";
+					break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char buffer[7];
+						std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+						os << buffer;
+					}
+					else
+						os << c;
+				}
+			}
+			os << '"';
+		}
+
+		inline void write_json(std::ostream &os, const std::vector<leak_report_entry> &entries)
+		{
+			size_t total{};
+			for (const auto &entry : entries)
+				total += entry.count;
+
+			os << "{\n  \"sampling_rate\": " << scale() << ",\n  \"references\": " << total << ",\n  \"entries\": [";
+			bool first_entry = true;
+			for (const auto &entry : entries)
+			{
+				os << (first_entry ? "\n" : ",\n") << "    {\n      \"class\": ";
+				first_entry = false;
+				write_string(os, entry.class_name);
+				os << ",\n      \"count\": " << entry.count << ",\n      \"first_ordinal\": " << entry.first_ordinal << ",\n      \"last_ordinal\": " << entry.last_ordinal << ",\n      \"stack\": [";
+				for (uint32_t i = 0; i != entry.stack->size; ++i)
+				{
+					os << (i ? ", " : "") << '"';
+					write_address(os, entry.stack->frames[i]);
+					os << '"';
+				}
+				os << "],\n      \"frames\": [";
+				for (uint32_t i = 0; i != entry.stack->size; ++i)
+				{
+					os << (i ? ",\n        " : "\n        ");
+					write_string(os, entry.stack->symbolize(i));
+				}
+				os << (entry.stack->size ? "\n      ]\n    }" : "]\n    }");
+			}
+			os << (entries.empty() ? "]\n}\n" : "\n  ]\n}\n");
+		}
+
+		inline void write_pprof(std::ostream &os, const std::vector<leak_report_entry> &entries)
+		{
+			// Each reference is counted as one object of one byte
+			const auto factor = scale();
+			size_t total{};
+			for (const auto &entry : entries)
+				total += entry.count * factor;
+
+			os << "heap profile: " << total << ": " << total << " [" << total << ": " << total << "] @ heapprofile\n";
+			for (const auto &entry : entries)
+			{
+				const auto count = entry.count * factor;
+				os << count << ": " << count << " [" << count << ": " << count << "] @";
+				for (uint32_t i = 0; i != entry.stack->size; ++i)
+				{
+					os << ' ';
+					write_address(os, entry.stack->frames[i]);
+				}
+				os << '\n';
+			}
+
+#if defined(__linux__)
+			os << "\nMAPPED_LIBRARIES:\n";
+			std::ifstream maps{ "/proc/self/maps" };
+			os << maps.rdbuf();
+#endif
+		}
+
+		struct exit_settings
+		{
+			std::filesystem::path path;
+			leak_report_format format;
+		};
+	}
+
+	inline void write_leak_report(std::ostream &os, leak_report_format format = leak_report_format::json)
+	{
+		const auto entries = get_leak_report();
+		if (format == leak_report_format::json)
+			report::write_json(os, entries);
+		else
+			report::write_pprof(os, entries);
+	}
+
+	// Returns false if the file cannot be written
+	inline bool write_leak_report(const std::filesystem::path &path, leak_report_format format = leak_report_format::json)
+	{
+		std::ofstream os{ path, std::ios::binary | std::ios::trunc };
+		if (!os)
+			return false;
+		write_leak_report(os, format);
+		return static_cast<bool>(os.flush());
+	}
+
+	// Writes the report when the program exits. References held by static objects that are destroyed later are reported as
+	// well. Subsequent calls change the file and format. Not thread-safe
+	inline void write_leak_report_at_exit(std::filesystem::path path, leak_report_format format = leak_report_format::json)
+	{
+		// Never destroyed, the report is written during static destruction
+		static report::exit_settings *settings = []
+		{
+			std::atexit([]
+			{
+				try
+				{
+					write_leak_report(settings->path, settings->format);
+				}
+				catch (...)
+				{
+				}
+			});
+			return new report::exit_settings{};
+		}();
+
+		settings->path = std::move(path);
+		settings->format = format;
+	}
+}
+
+namespace belt::com
+{
+	using details::leak_report_entry;
+	using details::leak_report_format;
+	using details::get_leak_report;
+	using details::write_leak_report;
+	using details::write_leak_report_at_exit;
+}
@@ -0,0 +1,118 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <string_view>
+
+#include "../com_ptr.h"
+#include "leak_table.h"
+
+// Sampling leak profiler
+//
+// Each thread counts down a random number of AddRef calls per class, with the mean set by the sampling rate. When the
+// countdown expires, the reference is recorded in the leak table together with its call stack, and its cookie travels
+// with com_ptr until the matching Release removes the record. Records that remain are the surviving sampled owners.
+
+#if !defined(BELT_COM_LEAK_SAMPLING_RATE)
+#define BELT_COM_LEAK_SAMPLING_RATE 1024
+#endif
+
+namespace belt::com::details
+{
+	namespace sampling
+	{
+		// Mean number of AddRef calls per sample, 0 disables sampling
+		inline std::atomic<unsigned> rate{ BELT_COM_LEAK_SAMPLING_RATE };
+		constexpr unsigned max_rate = INT_MAX / 2;
+		// While sampling is disabled, threads check if it has been enabled after this many AddRef calls
+		constexpr int recheck_interval = 65536;
+
+		inline constinit thread_local uint64_t random_state{};
+
+		// Number of AddRef calls to skip before the next sample, uniformly distributed in [0, 2 * r - 2] so that one out of r
+		// calls is sampled on average
+		inline int next_interval(unsigned r) noexcept
+		{
+			if (!random_state)
+				random_state = (reinterpret_cast<uintptr_t>(&random_state) ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())) * 0x9e3779b97f4a7c15ull | 1;
+
+			// xorshift64*
+			auto x = random_state;
+			x ^= x >> 12;
+			x ^= x << 25;
+			x ^= x >> 27;
+			random_state = x;
+			return static_cast<int>(((x * 0x2545f4914f6cdd1dull) >> 32) % (2 * uint64_t{ r } - 1));
+		}
+
+		// Records a sampled reference and passes its cookie to com_ptr
+		inline void record(const void *object, std::string_view class_name) noexcept
+		{
+			try
+			{
+				set_current_cookie(get_leak_table().insert(object, class_name));
+			}
+			catch (...)
+			{
+			}
+		}
+
+		BELT_NOINLINE inline void forget(int cookie, const void *object) noexcept
+		{
+			get_leak_table().erase(cookie, object);
+		}
+
+		template<class Class>
+		struct sampler
+		{
+			// Constant-initialized, so the fast path does not need to check for thread-local initialization
+			static inline constinit thread_local int countdown{};
+			static inline constinit thread_local bool armed{};
+
+			// Called on every AddRef, the fast path is a decrement and a single branch
+			static void on_add_ref(const void *object) noexcept
+			{
+				if (--countdown < 0) [[unlikely]]
+					expire(object);
+			}
+
+			BELT_NOINLINE static void expire(const void *object) noexcept
+			{
+				// The first expiration on a thread only starts the countdown
+				const bool was_armed = armed;
+				const auto r = std::min(rate.load(std::memory_order_relaxed), max_rate);
+				armed = r != 0;
+				countdown = r ? next_interval(r) : recheck_interval;
+				if (was_armed && r)
+					record(object, leak_class_name<Class>);
+			}
+		};
+	}
+
+	inline void set_leak_sampling_rate(unsigned rate) noexcept
+	{
+		sampling::rate.store(std::min(rate, sampling::max_rate), std::memory_order_relaxed);
+	}
+
+	inline unsigned get_leak_sampling_rate() noexcept
+	{
+		return sampling::rate.load(std::memory_order_relaxed);
+	}
+}
+
+namespace belt::com
+{
+	using details::set_leak_sampling_rate;
+	using details::get_leak_sampling_rate;
+}
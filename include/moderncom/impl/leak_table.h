@@ -0,0 +1,165 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "srwlock.h"
+#include "stack_table.h"
+#include "type_name.h"
+
+namespace belt::com::details
+{
+	template<class T>
+	inline constexpr std::string_view leak_class_name = type_name<T>();
+
+	// Record of a single AddRef call that has not yet been matched with Release
+	struct leak_detection
+	{
+		int ordinal;
+		const void *object;
+		// Name of the object's class
+		std::string_view class_name;
+		// Call stack of AddRef, shared by all records with the same stack
+		const stack_entry *stack;
+		// Hash chain or free list
+		leak_detection *next;
+
+		static int get_next() noexcept
+		{
+			static std::atomic<int> global_ordinal{};
+			return ++global_ordinal;
+		}
+	};
+
+	// Process-wide table of outstanding records, keyed by ordinal. Consecutive ordinals go to different shards, each with
+	// its own lock, chained hash table and free list of records
+	class leak_table
+	{
+		static constexpr size_t shard_count = 64;
+		static constexpr size_t initial_buckets = 64;
+
+		struct alignas(64) shard
+		{
+			srwlock lock;
+			std::vector<leak_detection *> buckets;
+			size_t size{};
+			leak_detection *free_list{};
+
+			leak_detection *&bucket(int ordinal) noexcept
+			{
+				return buckets[(static_cast<size_t>(ordinal) / shard_count) & (buckets.size() - 1)];
+			}
+
+			void grow()
+			{
+				std::vector<leak_detection *> old(buckets.empty() ? initial_buckets : buckets.size() * 2);
+				std::swap(old, buckets);
+				for (auto chain : old)
+				{
+					while (chain)
+					{
+						auto record = std::exchange(chain, chain->next);
+						auto &head = bucket(record->ordinal);
+						record->next = head;
+						head = record;
+					}
+				}
+			}
+		};
+
+		shard shards[shard_count];
+
+		static shard &shard_of(shard *shards, int ordinal) noexcept
+		{
+			return shards[static_cast<size_t>(ordinal) % shard_count];
+		}
+
+	public:
+		// Captures current stack and returns the new record's ordinal
+		int insert(const void *object, std::string_view class_name)
+		{
+			auto stack = get_stack_table().capture();
+			const auto ordinal = leak_detection::get_next();
+			auto &s = shard_of(shards, ordinal);
+
+			std::scoped_lock l{ s.lock };
+			if (s.size >= s.buckets.size())
+				s.grow();
+
+			auto record = s.free_list;
+			if (record)
+				s.free_list = record->next;
+			else
+				record = new leak_detection;
+
+			record->ordinal = ordinal;
+			record->object = object;
+			record->class_name = class_name;
+			record->stack = stack;
+			auto &head = s.bucket(ordinal);
+			record->next = head;
+			head = record;
+			++s.size;
+			return ordinal;
+		}
+
+		// Returns false if there is no record with the given ordinal for the object
+		bool erase(int ordinal, const void *object) noexcept
+		{
+			auto &s = shard_of(shards, ordinal);
+			std::scoped_lock l{ s.lock };
+			if (s.buckets.empty())
+				return false;
+
+			for (auto *link = &s.bucket(ordinal); *link; link = &(*link)->next)
+			{
+				auto record = *link;
+				if (record->ordinal == ordinal)
+				{
+					if (record->object != object)
+						return false;
+					*link = record->next;
+					record->next = s.free_list;
+					s.free_list = record;
+					--s.size;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Calls f for each outstanding record. f must not add or release references to objects with leak detection
+		template<class F>
+		void for_each(F &&f)
+		{
+			for (auto &s : shards)
+			{
+				std::shared_lock l{ s.lock };
+				for (auto chain : s.buckets)
+					for (; chain; chain = chain->next)
+						f(static_cast<const leak_detection &>(*chain));
+			}
+		}
+	};
+
+	// Never destroyed, objects may be released during static destruction
+	inline leak_table &get_leak_table() noexcept
+	{
+		static auto *table = new leak_table;
+		return *table;
+	}
+}
@@ -131,20 +131,20 @@ namespace belt::details
 
 #define SCOPE_FAIL \
 auto ANONYMOUS_VARIABLE(SCOPE_FAIL_STATE) \
-= ::Belt::details::ScopeGuardOnFail() + [&]() noexcept \
+= ::belt::details::ScopeGuardOnFail() + [&]() noexcept \
 // end of macro
 
 #define SCOPE_SUCCESS \
 auto ANONYMOUS_VARIABLE(SCOPE_SUCCESS_STATE) \
-= ::Belt::details::ScopeGuardOnSuccess() + [&]() \
+= ::belt::details::ScopeGuardOnSuccess() + [&]() \
 // end of macro
 
 #define SCOPE_EXIT \
 auto ANONYMOUS_VARIABLE(SCOPE_EXIT_STATE) \
-= ::Belt::details::ScopeGuardOnExit() + [&]() noexcept \
+= ::belt::details::ScopeGuardOnExit() + [&]() noexcept \
 // end of macro
 
 #define SCOPE_EXIT_CANCELLABLE(name) \
 auto name\
-= ::Belt::details::ScopeGuardOnExitCancellable() + [&]() noexcept \
+= ::belt::details::ScopeGuardOnExitCancellable() + [&]() noexcept \
 // end of macro
@@ -0,0 +1,125 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+// Compiler-specific attributes used throughout the library
+#if defined(_MSC_VER)
+#define BELT_EMPTY_BASES __declspec(empty_bases)
+#define BELT_NOVTABLE __declspec(novtable)
+#define BELT_SELECTANY __declspec(selectany)
+#define BELT_UUID(id) __declspec(uuid(id))
+#define BELT_NOINLINE __declspec(noinline)
+#else
+#define BELT_EMPTY_BASES
+#define BELT_NOVTABLE
+#define BELT_SELECTANY
+#define BELT_UUID(id)
+#define BELT_NOINLINE __attribute__((noinline))
+#endif
+
+// Symbol visibility for ELF and Mach-O shared libraries. Every DLL has its own copy of symbols regardless
+#if defined(_WIN32)
+#define BELT_EXPORTED
+#define BELT_MODULE_LOCAL
+#else
+#define BELT_EXPORTED __attribute__((visibility("default")))
+#define BELT_MODULE_LOCAL __attribute__((visibility("hidden")))
+#endif
+
+#if defined(_WIN32)
+
+#include <unknwn.h>
+
+#else
+
+// Minimal stand-in for the parts of the Windows SDK used by the library. It allows the very same object<> and com_ptr<>
+// code to be compiled (and profiled) on platforms without COM runtime. Layout of IUnknown and GUID matches Windows.
+
+#include <cstdint>
+#include "../guid.h"
+
+using HRESULT = int32_t;
+using ULONG = uint32_t;
+using DWORD = uint32_t;
+using BOOL = int;
+using LPVOID = void *;
+
+using IID = GUID;
+using CLSID = GUID;
+using REFGUID = const GUID &;
+using REFIID = const IID &;
+using REFCLSID = const CLSID &;
+
+#define STDMETHODCALLTYPE
+#define WINAPI
+
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr) (static_cast<HRESULT>(hr) < 0)
+
+#define S_OK static_cast<HRESULT>(0x00000000L)
+#define S_FALSE static_cast<HRESULT>(0x00000001L)
+#define E_NOTIMPL static_cast<HRESULT>(0x80004001L)
+#define E_NOINTERFACE static_cast<HRESULT>(0x80004002L)
+#define E_POINTER static_cast<HRESULT>(0x80004003L)
+#define E_ABORT static_cast<HRESULT>(0x80004004L)
+#define E_FAIL static_cast<HRESULT>(0x80004005L)
+#define E_UNEXPECTED static_cast<HRESULT>(0x8000FFFFL)
+#define E_OUTOFMEMORY static_cast<HRESULT>(0x8007000EL)
+#define E_INVALIDARG static_cast<HRESULT>(0x80070057L)
+#define CLASS_E_NOAGGREGATION static_cast<HRESULT>(0x80040110L)
+#define CLASS_E_CLASSNOTAVAILABLE static_cast<HRESULT>(0x80040111L)
+#define REGDB_E_CLASSNOTREG static_cast<HRESULT>(0x80040154L)
+
+#define ERROR_OPERATION_ABORTED 995L
+
+constexpr HRESULT HRESULT_FROM_WIN32(long x) noexcept
+{
+	return x <= 0 ? static_cast<HRESULT>(x) : static_cast<HRESULT>((x & 0x0000FFFF) | (7 << 16) | 0x80000000);
+}
+
+enum CLSCTX : DWORD
+{
+	CLSCTX_INPROC_SERVER = 0x1,
+	CLSCTX_INPROC_HANDLER = 0x2,
+	CLSCTX_LOCAL_SERVER = 0x4,
+	CLSCTX_REMOTE_SERVER = 0x10,
+	CLSCTX_ALL = CLSCTX_INPROC_SERVER | CLSCTX_INPROC_HANDLER | CLSCTX_LOCAL_SERVER | CLSCTX_REMOTE_SERVER,
+};
+
+struct IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) = 0;
+	virtual ULONG STDMETHODCALLTYPE AddRef() = 0;
+	virtual ULONG STDMETHODCALLTYPE Release() = 0;
+};
+
+inline constexpr GUID get_guid(IUnknown *) noexcept
+{
+	return belt::com::make_guid("{00000000-0000-0000-C000-000000000046}");
+}
+
+struct IClassFactory : IUnknown
+{
+	virtual HRESULT STDMETHODCALLTYPE CreateInstance(IUnknown *pUnkOuter, REFIID riid, void **ppvObject) = 0;
+	virtual HRESULT STDMETHODCALLTYPE LockServer(BOOL fLock) = 0;
+};
+
+inline constexpr GUID get_guid(IClassFactory *) noexcept
+{
+	return belt::com::make_guid("{00000001-0000-0000-C000-000000000046}");
+}
+
+// There is no system class registry, use belt::com::create_object for in-process objects instead
+inline HRESULT CoCreateInstance(REFCLSID, IUnknown *, DWORD, REFIID, void **ppv) noexcept
+{
+	*ppv = nullptr;
+	return REGDB_E_CLASSNOTREG;
+}
+
+#endif
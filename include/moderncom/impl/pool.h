@@ -0,0 +1,283 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <vector>
+
+#include "srwlock.h"
+
+// Size-class object pool
+//
+// Blocks are rounded up to a multiple of granularity and served from per-thread free lists. A thread refills its list
+// from (and returns surplus to) a global list for the size class in batches. Memory is carved from the system in chunks
+// and never returned to it. Requests larger than max_block_size go to global operator new.
+
+namespace belt::com::details::pool
+{
+	constexpr size_t granularity = 16;
+	constexpr size_t max_block_size = 1024;
+	constexpr size_t size_class_count = max_block_size / granularity;
+	constexpr size_t batch_size = 32;
+	constexpr size_t chunk_size = 64 * 1024;
+
+	constexpr size_t size_class(size_t size) noexcept
+	{
+		return (std::max<size_t>(size, 1) + granularity - 1) / granularity - 1;
+	}
+
+	constexpr size_t block_size(size_t cls) noexcept
+	{
+		return (cls + 1) * granularity;
+	}
+
+	struct free_block
+	{
+		free_block *next;
+	};
+
+	struct central_list
+	{
+		srwlock lock;
+		free_block *head{};
+		size_t free_count{};
+		// Statistics, in blocks
+		size_t reserved{};
+		size_t outstanding{};
+		size_t high_water{};
+
+		// Must be called under lock
+		void carve(size_t size, size_t min_count)
+		{
+			const auto count = std::max(min_count, chunk_size / size);
+			auto chunk = static_cast<char *>(::operator new(count * size));
+			for (size_t i = 0; i != count; ++i)
+			{
+				auto block = reinterpret_cast<free_block *>(chunk + i * size);
+				block->next = head;
+				head = block;
+			}
+			free_count += count;
+			reserved += count;
+		}
+
+		// Must be called under lock
+		free_block *take(size_t size, size_t count)
+		{
+			if (free_count < count)
+				carve(size, count - free_count);
+
+			auto first = head;
+			auto last = head;
+			for (size_t i = 1; i != count; ++i)
+				last = last->next;
+			head = last->next;
+			last->next = nullptr;
+			free_count -= count;
+			outstanding += count;
+			high_water = std::max(high_water, outstanding);
+			return first;
+		}
+
+		void give(free_block *first, free_block *last, size_t count) noexcept
+		{
+			std::scoped_lock l{ lock };
+			last->next = head;
+			head = first;
+			free_count += count;
+			outstanding -= count;
+		}
+	};
+
+	inline central_list central[size_class_count];
+
+	enum class cache_state : uint8_t
+	{
+		unregistered,
+		active,
+		closed,
+	};
+
+	// Constant-initialized, so the fast path does not need to check for thread-local initialization
+	struct thread_cache
+	{
+		free_block *head[size_class_count];
+		uint32_t count[size_class_count];
+		cache_state state;
+	};
+
+	inline constinit thread_local thread_cache cache{};
+
+	inline void flush(size_t cls) noexcept
+	{
+		if (auto first = cache.head[cls])
+		{
+			auto last = first;
+			while (last->next)
+				last = last->next;
+			central[cls].give(first, last, cache.count[cls]);
+			cache.head[cls] = nullptr;
+			cache.count[cls] = 0;
+		}
+	}
+
+	struct thread_cache_flusher
+	{
+		~thread_cache_flusher()
+		{
+			for (size_t cls = 0; cls != size_class_count; ++cls)
+				flush(cls);
+			// Blocks freed on this thread from now on go straight to the global lists
+			cache.state = cache_state::closed;
+		}
+	};
+
+	inline void register_thread() noexcept
+	{
+		static thread_local thread_cache_flusher flusher;
+		static_cast<void>(flusher);
+		cache.state = cache_state::active;
+	}
+
+	inline void *refill(size_t cls)
+	{
+		if (cache.state == cache_state::closed)
+		{
+			std::scoped_lock l{ central[cls].lock };
+			return central[cls].take(block_size(cls), 1);
+		}
+
+		if (cache.state == cache_state::unregistered)
+			register_thread();
+
+		free_block *block;
+		{
+			std::scoped_lock l{ central[cls].lock };
+			block = central[cls].take(block_size(cls), batch_size);
+		}
+		cache.head[cls] = block->next;
+		cache.count[cls] = batch_size - 1;
+		return block;
+	}
+
+	// Return a batch of blocks to the global list, keeping the rest in the cache
+	inline void release_batch(size_t cls) noexcept
+	{
+		auto first = cache.head[cls];
+		auto last = first;
+		for (size_t i = 1; i != batch_size; ++i)
+			last = last->next;
+		cache.head[cls] = last->next;
+		cache.count[cls] -= batch_size;
+		central[cls].give(first, last, batch_size);
+	}
+
+	inline void *allocate(size_t size)
+	{
+		if (size > max_block_size)
+			return ::operator new(size);
+
+		const auto cls = size_class(size);
+		if (auto block = cache.head[cls])
+		{
+			cache.head[cls] = block->next;
+			--cache.count[cls];
+			return block;
+		}
+		return refill(cls);
+	}
+
+	inline void deallocate(void *p, size_t size) noexcept
+	{
+		if (size > max_block_size)
+			return ::operator delete(p);
+
+		const auto cls = size_class(size);
+		auto block = static_cast<free_block *>(p);
+		if (cache.state != cache_state::active) [[unlikely]]
+		{
+			if (cache.state == cache_state::closed)
+				return central[cls].give(block, block, 1);
+			register_thread();
+		}
+
+		block->next = cache.head[cls];
+		cache.head[cls] = block;
+		if (++cache.count[cls] > 2 * batch_size)
+			release_batch(cls);
+	}
+
+	inline void reserve(size_t size, size_t count)
+	{
+		if (size > max_block_size)
+			return;
+
+		// Threads take blocks in batches, a thread that creates count objects takes the rounded up number of blocks
+		count = (count + batch_size - 1) / batch_size * batch_size;
+		const auto cls = size_class(size);
+		auto &list = central[cls];
+		std::scoped_lock l{ list.lock };
+		if (list.free_count < count)
+			list.carve(block_size(cls), count - list.free_count);
+	}
+
+	// Operators for pooled classes
+	template<class T>
+	struct pooled_allocation
+	{
+		static void *operator new(size_t size)
+		{
+			if constexpr (alignof(T) > granularity)
+				return ::operator new(size, std::align_val_t{ alignof(T) });
+			else
+				return allocate(size);
+		}
+
+		static void operator delete(void *p, size_t size) noexcept
+		{
+			if constexpr (alignof(T) > granularity)
+				::operator delete(p, std::align_val_t{ alignof(T) });
+			else
+				deallocate(p, size);
+		}
+	};
+}
+
+namespace belt::com
+{
+	struct pool_stats
+	{
+		size_t block_size;
+		// Blocks carved from the system
+		size_t reserved;
+		// Blocks held by threads, either used by objects or cached
+		size_t in_use;
+		// Maximum value of in_use
+		size_t high_water;
+	};
+
+	// Statistics for each size class that has been used
+	inline std::vector<pool_stats> get_pool_stats()
+	{
+		std::vector<pool_stats> result;
+		for (size_t cls = 0; cls != details::pool::size_class_count; ++cls)
+		{
+			auto &list = details::pool::central[cls];
+			std::shared_lock l{ list.lock };
+			if (list.reserved)
+				result.push_back({ details::pool::block_size(cls), list.reserved, list.outstanding, list.high_water });
+		}
+		return result;
+	}
+}
@@ -8,8 +8,15 @@
 
 #pragma once
 
+#include "platform.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 namespace belt
 {
+#if defined(_WIN32)
 	// Windows SRW lock wrapped in shared_mutex-friendly class
 	class srwlock
 	{
@@ -49,5 +56,41 @@ namespace belt
 			ReleaseSRWLockShared(&m_lock);
 		}
 	};
+#else
+	// POSIX read-write lock wrapped in the same interface. Like SRWLOCK, it is statically initialized and never destroyed
+	class srwlock
+	{
+		pthread_rwlock_t m_lock = PTHREAD_RWLOCK_INITIALIZER;
+	public:
+		srwlock(const srwlock &) = delete;
+		srwlock & operator=(const srwlock &) = delete;
+		srwlock() noexcept = default;
+
+		void lock() noexcept
+		{
+			pthread_rwlock_wrlock(&m_lock);
+		}
+
+		void lock_shared() noexcept
+		{
+			pthread_rwlock_rdlock(&m_lock);
+		}
+
+		bool try_lock() noexcept
+		{
+			return 0 == pthread_rwlock_trywrlock(&m_lock);
+		}
+
+		void unlock() noexcept
+		{
+			pthread_rwlock_unlock(&m_lock);
+		}
+
+		void unlock_shared() noexcept
+		{
+			pthread_rwlock_unlock(&m_lock);
+		}
+	};
+#endif
 }
 
@@ -0,0 +1,251 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// If you get a compilation error at the following line, do one of the following:
+//		- Add boost 1.73.0 or later to your project
+//		or
+//		- #define BELT_COM_NO_LEAK_DETECTION before including any library's header to disable leak detection
+#include <boost/stacktrace.hpp>
+
+#include "srwlock.h"
+
+// Walking frame pointers is much faster than unwinding with unwind tables, but requires code to be compiled with frame
+// pointers. It is the default for unoptimized builds, define BELT_STACK_CAPTURE_FRAME_POINTERS=1 for optimized code
+// compiled with -fno-omit-frame-pointer
+#if !defined(BELT_STACK_CAPTURE_FRAME_POINTERS)
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)) && !defined(__OPTIMIZE__)
+#define BELT_STACK_CAPTURE_FRAME_POINTERS 1
+#else
+#define BELT_STACK_CAPTURE_FRAME_POINTERS 0
+#endif
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif BELT_STACK_CAPTURE_FRAME_POINTERS
+#include <pthread.h>
+#endif
+
+// Deduplicated call stacks
+//
+// A stack is captured as raw return addresses into a fixed-size buffer and interned in a process-wide table, so each
+// distinct stack is stored once. Addresses are only resolved to function names and source lines when a stack is printed.
+
+namespace belt::com::details
+{
+	// Stores up to max return addresses of the caller's stack into frames, returns the number of stored addresses
+#if defined(_WIN32)
+	BOOST_NOINLINE inline uint32_t capture_frames(const void **frames, uint32_t max, uint32_t skip) noexcept
+	{
+		return RtlCaptureStackBackTrace(skip + 1, max, const_cast<void **>(frames), nullptr);
+	}
+#elif BELT_STACK_CAPTURE_FRAME_POINTERS
+	struct thread_stack_bounds
+	{
+		uintptr_t low{}, high{};
+
+		thread_stack_bounds() noexcept
+		{
+			pthread_attr_t attr;
+			if (0 == pthread_getattr_np(pthread_self(), &attr))
+			{
+				void *address;
+				size_t size;
+				if (0 == pthread_attr_getstack(&attr, &address, &size))
+				{
+					low = reinterpret_cast<uintptr_t>(address);
+					high = low + size;
+				}
+				pthread_attr_destroy(&attr);
+			}
+		}
+	};
+
+	BOOST_NOINLINE inline uint32_t capture_frames(const void **frames, uint32_t max, uint32_t skip) noexcept
+	{
+		static thread_local thread_stack_bounds bounds;
+		// Each frame record holds a pointer to the caller's record followed by the return address. Records that are not
+		// inside this thread's stack or do not move towards its base end the walk
+		auto frame = static_cast<void *const *>(__builtin_frame_address(0));
+		uint32_t count{};
+		while (count != max)
+		{
+			const auto address = reinterpret_cast<uintptr_t>(frame);
+			if (address < bounds.low || address + 2 * sizeof(void *) > bounds.high || (address & (sizeof(void *) - 1)))
+				break;
+			if (skip)
+				--skip;
+			else
+				frames[count++] = frame[1];
+			const auto next = static_cast<void *const *>(frame[0]);
+			if (next <= frame)
+				break;
+			frame = next;
+		}
+		return count;
+	}
+#else
+	BOOST_NOINLINE inline uint32_t capture_frames(const void **frames, uint32_t max, uint32_t skip) noexcept
+	{
+		// One extra slot for the terminating null frame
+		const void *buffer[64 + 1];
+		const auto count = boost::stacktrace::safe_dump_to(skip + 1, buffer, (std::min<size_t>(max, 64) + 1) * sizeof(void *));
+		const auto frames_count = static_cast<uint32_t>(count ? count - 1 : 0);
+		std::memcpy(frames, buffer, frames_count * sizeof(void *));
+		return frames_count;
+	}
+#endif
+
+	struct stack_entry
+	{
+		static constexpr size_t max_frames = 32;
+
+		const stack_entry *next;
+		uint64_t hash;
+		uint32_t size;
+		const void *frames[max_frames];
+
+		std::string symbolize() const
+		{
+			std::string result;
+			for (uint32_t i = 0; i != size; ++i)
+			{
+				result += std::to_string(i);
+				result += "# ";
+				result += symbolize(i);
+				result += '\n';
+			}
+			return result;
+		}
+
+		std::string symbolize(uint32_t index) const
+		{
+			return boost::stacktrace::to_string(boost::stacktrace::frame{ frames[index] });
+		}
+	};
+
+	class stack_table
+	{
+		static constexpr size_t shard_count = 16;
+		static constexpr size_t initial_buckets = 256;
+
+		struct alignas(64) shard
+		{
+			srwlock lock;
+			std::vector<const stack_entry *> buckets;
+			size_t size{};
+
+			const stack_entry *find(uint64_t hash, const void *const *frames, uint32_t count) const noexcept
+			{
+				if (buckets.empty())
+					return nullptr;
+				for (auto entry = buckets[(hash / shard_count) & (buckets.size() - 1)]; entry; entry = entry->next)
+					if (entry->hash == hash && entry->size == count && 0 == std::memcmp(entry->frames, frames, count * sizeof(void *)))
+						return entry;
+				return nullptr;
+			}
+
+			void link(stack_entry *entry)
+			{
+				if (size >= buckets.size())
+				{
+					std::vector<const stack_entry *> old(buckets.empty() ? initial_buckets : buckets.size() * 2);
+					std::swap(old, buckets);
+					for (auto chain : old)
+					{
+						while (chain)
+						{
+							auto moved = const_cast<stack_entry *>(std::exchange(chain, chain->next));
+							auto &head = buckets[(moved->hash / shard_count) & (buckets.size() - 1)];
+							moved->next = head;
+							head = moved;
+						}
+					}
+				}
+
+				auto &head = buckets[(entry->hash / shard_count) & (buckets.size() - 1)];
+				entry->next = head;
+				head = entry;
+				++size;
+			}
+		};
+
+		shard shards[shard_count];
+
+		static uint64_t hash_frames(const void *const *frames, uint32_t count) noexcept
+		{
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for (uint32_t i = 0; i != count; ++i)
+			{
+				hash ^= reinterpret_cast<uintptr_t>(frames[i]);
+				hash *= 0x100000001b3ull;
+				hash ^= hash >> 29;
+			}
+			return hash;
+		}
+
+	public:
+		// Captures current call stack, skipping given number of innermost frames, and returns its interned copy
+		BOOST_NOINLINE const stack_entry *capture(uint32_t skip = 0)
+		{
+			const void *frames[stack_entry::max_frames];
+			return intern(frames, capture_frames(frames, stack_entry::max_frames, skip + 1));
+		}
+
+		const stack_entry *intern(const void *const *frames, uint32_t count)
+		{
+			const auto hash = hash_frames(frames, count);
+			auto &s = shards[hash % shard_count];
+			{
+				std::shared_lock l{ s.lock };
+				if (auto entry = s.find(hash, frames, count))
+					return entry;
+			}
+
+			std::scoped_lock l{ s.lock };
+			if (auto entry = s.find(hash, frames, count))
+				return entry;
+
+			auto entry = new stack_entry{ nullptr, hash, count, {} };
+			std::memcpy(entry->frames, frames, count * sizeof(void *));
+			s.link(entry);
+			return entry;
+		}
+
+		size_t size() noexcept
+		{
+			size_t result{};
+			for (auto &s : shards)
+			{
+				std::shared_lock l{ s.lock };
+				result += s.size;
+			}
+			return result;
+		}
+	};
+
+	// Never destroyed, entries are referenced by records that may outlive static destruction
+	inline stack_table &get_stack_table() noexcept
+	{
+		static auto *table = new stack_table;
+		return *table;
+	}
+}
@@ -0,0 +1,35 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+
+namespace belt::com::details
+{
+	// Class name extracted from the signature of this function, does not require RTTI
+	template<class T>
+	constexpr std::string_view type_name() noexcept
+	{
+#if defined(_MSC_VER)
+		constexpr std::string_view signature = __FUNCSIG__;
+		constexpr auto start = signature.find("type_name<") + 10;
+		constexpr auto end = signature.rfind(">(void)");
+#else
+		constexpr std::string_view signature = __PRETTY_FUNCTION__;
+		constexpr auto start = signature.find("T = ") + 4;
+		constexpr auto end = std::min(signature.find(';', start), signature.rfind(']'));
+#endif
+		auto name = signature.substr(start, end - start);
+		for (std::string_view prefix : { "class ", "struct " })
+			if (name.starts_with(prefix))
+				name.remove_prefix(prefix.size());
+		return name;
+	}
+}
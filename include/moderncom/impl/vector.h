@@ -80,6 +80,31 @@ namespace belt::mpl
 	template<class A, class B>
 	using append_t = typename append<A, B>::type;
 
+	// join
+	template<class... Vectors>
+	struct join;
+
+	template<>
+	struct join<>
+	{
+		typedef vector<> type;
+	};
+
+	template<class... Types>
+	struct join<vector<Types...>>
+	{
+		typedef vector<Types...> type;
+	};
+
+	template<class... TypesA, class... TypesB, class... Rest>
+	struct join<vector<TypesA...>, vector<TypesB...>, Rest...>
+	{
+		typedef typename join<vector<TypesA..., TypesB...>, Rest...>::type type;
+	};
+
+	template<class... Vectors>
+	using join_t = typename join<Vectors...>::type;
+
 	// front
 	template<class T>
 	struct front;
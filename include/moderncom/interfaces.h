@@ -10,7 +10,14 @@
 #pragma once
 #include <atomic>
 #include <type_traits>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <memory_resource>
 
 #if defined(_DEBUG)
 #include <vector>
@@ -18,8 +25,24 @@
 
 #include "impl/vector.h"
 #include "impl/errors.h"
+#include "impl/biased_ref_count.h"
+#include "impl/pool.h"
+#include "impl/class_registry.h"
+#include "impl/cycle_collector.h"
+#include "impl/deferred_destruction.h"
+#include "impl/type_name.h"
 
 #include "com_ptr.h"
+#include "weak_ref.h"
+#include "multi_ptr.h"
+
+#if BELT_HAS_LEAK_SAMPLING
+#include "impl/leak_sampling.h"
+#endif
+
+#if BELT_HAS_REF_COOKIES
+#include "impl/leak_report.h"
+#endif
 
 namespace belt::com
 {
@@ -30,7 +53,7 @@ namespace belt::com
 			static std::atomic<int> lock_count;
 		};
 
-		inline __declspec(selectany) std::atomic<int> ModuleCount::lock_count{};
+		inline BELT_SELECTANY std::atomic<int> ModuleCount::lock_count{};
 
 #pragma region object
 		struct supports_aggregation_t {};
@@ -38,12 +61,17 @@ namespace belt::com
 		struct smart_singleton_factory_t {};
 		struct increments_module_count_t {};
 		struct enable_leak_detection_t {};
+		struct pooled_t {};
+		struct collects_cycles_t {};
+		struct deferred_destruction_t {};
+		// Common base of reference count traits
+		struct ref_count_trait_t {};
 
 		struct delayed_t {};
 		constexpr const delayed_t delayed = {};
 
 		template<class Interface>
-		struct __declspec(empty_bases)embeds_interface_id {};
+		struct BELT_EMPTY_BASES embeds_interface_id {};
 
 		// get_first
 		template<class T>
@@ -108,6 +136,50 @@ namespace belt::com
 		template<class T>
 		using has_smart_singleton_factory = has_smart_singleton_factory_impl<T, void>;
 
+		// Interface map flattening
+		// Entries that describe their static part (can_query::interfaces) are flattened into a compile-time query map.
+		// Entries that cannot be answered with a simple cast (aggregates, eats_all and custom entries) are "dynamic" and
+		// are queried by the recursive fold after the query map lookup fails.
+		template<class T>
+		concept has_static_query = requires
+		{
+			typename T::can_query::interfaces;
+		};
+
+		template<class Entry>
+		struct query_map_traits
+		{
+			using interfaces = mpl::vector<Entry>;
+			static constexpr bool dynamic = false;
+		};
+
+		template<class Entry> requires has_static_query<Entry>
+		struct query_map_traits<Entry>
+		{
+			using interfaces = typename Entry::can_query::interfaces;
+			static constexpr bool dynamic = Entry::can_query::dynamic;
+		};
+
+		template<class Entry> requires (has_implements<Entry> && !has_static_query<Entry>)
+		struct query_map_traits<Entry>
+		{
+			using interfaces = mpl::vector<>;
+			static constexpr bool dynamic = true;
+		};
+
+		template<>
+		struct query_map_traits<IUnknown>
+		{
+			using interfaces = mpl::vector<>;
+			static constexpr bool dynamic = false;
+		};
+
+		template<class...Entries>
+		using query_map_interfaces_t = mpl::join_t<mpl::vector<>, typename query_map_traits<Entries>::interfaces...>;
+
+		template<class...Entries>
+		constexpr const bool query_map_dynamic_v = (false || ... || query_map_traits<Entries>::dynamic);
+
 		//
 
 		template<class Interface, class T>
@@ -131,12 +203,12 @@ namespace belt::com
 		inline void *query(T *pobj, const GUID &iid, mpl::vector<Interfaces...>) noexcept
 		{
 			void *result{ nullptr };
-			(... || (nullptr != (result = query_single<Interfaces>(pobj, iid))));
+			static_cast<void>((... || (nullptr != (result = query_single<Interfaces>(pobj, iid)))));
 			return result;
 		}
 
 		template<class...Interfaces>
-		struct __declspec(empty_bases)extends_base : public Interfaces...
+		struct BELT_EMPTY_BASES extends_base : public Interfaces...
 		{
 			template<class Derived>
 			static void *query_children(Derived *pobject, const GUID &riid) noexcept
@@ -147,11 +219,13 @@ namespace belt::com
 
 		// extends marks derived as pure interface
 		template<class ThisInterface, class...Interfaces>
-		struct __declspec(empty_bases)extends : public extends_base<Interfaces...>
+		struct BELT_EMPTY_BASES extends : public extends_base<Interfaces...>
 		{
 			struct can_query
 			{
 				using type = mpl::vector<Interfaces...>;
+				using interfaces = mpl::join_t<mpl::vector<ThisInterface>, query_map_interfaces_t<Interfaces...>>;
+				static constexpr bool dynamic = query_map_dynamic_v<Interfaces...>;
 			};
 
 			template<class Derived>
@@ -190,11 +264,13 @@ namespace belt::com
 		}
 
 		template<class ThisClass, class FirstInterface, class...RestInterfaces>
-		struct __declspec(empty_bases)intermediate : public extends_base<FirstInterface, RestInterfaces...>
+		struct BELT_EMPTY_BASES intermediate : public extends_base<FirstInterface, RestInterfaces...>
 		{
 			struct can_query
 			{
 				using type = mpl::vector<FirstInterface, RestInterfaces...>;
+				using interfaces = query_map_interfaces_t<FirstInterface, RestInterfaces...>;
+				static constexpr bool dynamic = query_map_dynamic_v<FirstInterface, RestInterfaces...>;
 			};
 
 			template<class Derived>
@@ -210,7 +286,7 @@ namespace belt::com
 		};
 
 		template<class ThisClass>
-		struct __declspec(empty_bases)eats_all : public extends_base<>
+		struct BELT_EMPTY_BASES eats_all : public extends_base<>
 		{
 			struct can_query
 			{
@@ -225,7 +301,7 @@ namespace belt::com
 		};
 
 		template<class ThisClass, class...Interfaces>
-		struct __declspec(empty_bases)aggregates
+		struct BELT_EMPTY_BASES aggregates
 		{
 			struct can_query
 			{
@@ -242,11 +318,13 @@ namespace belt::com
 		};
 
 		template<class...Interfaces>
-		struct __declspec(empty_bases)also	// no inheriting from interfaces!
+		struct BELT_EMPTY_BASES also	// no inheriting from interfaces!
 		{
 			struct can_query
 			{
 				using type = mpl::vector<Interfaces...>;
+				using interfaces = query_map_interfaces_t<Interfaces...>;
+				static constexpr bool dynamic = query_map_dynamic_v<Interfaces...>;
 			};
 
 			template<class Derived>
@@ -256,6 +334,174 @@ namespace belt::com
 			}
 		};
 
+		// Query map
+		// A perfect hash table of all statically implemented interfaces, built at compile time. Each slot holds an IID key
+		// and a "this-adjusting" cast to the interface. Query map lookup does not call AddRef.
+		struct query_map_key
+		{
+			uint64_t lo;
+			uint64_t hi;
+
+			constexpr bool operator ==(const query_map_key &) const noexcept = default;
+		};
+
+		constexpr query_map_key make_query_map_key(const GUID &iid) noexcept
+		{
+			auto words = guid_words(iid);
+			return { words[0], words[1] };
+		}
+
+		// Multiplicative hash of both halves of the key. Only the seed and table size are chosen at compile time
+		struct query_map_hash
+		{
+			uint64_t seed;
+			unsigned bits;
+
+			constexpr size_t operator()(const query_map_key &key) const noexcept
+			{
+				return static_cast<size_t>((((key.lo * seed) ^ key.hi) * seed) >> (64 - bits));
+			}
+		};
+
+		template<size_t N>
+		constexpr query_map_hash find_query_map_hash(const std::array<query_map_key, N> &keys) noexcept
+		{
+			constexpr unsigned max_attempts = 4096;
+			unsigned bits = 1;
+			while ((size_t{ 1 } << bits) < 2 * N)
+				++bits;
+
+			uint64_t state{};
+			for (;; ++bits)
+			{
+				for (unsigned attempt = 0; attempt < max_attempts; ++attempt)
+				{
+					// splitmix64 sequence of odd seeds
+					uint64_t seed = (state += 0x9e3779b97f4a7c15);
+					seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9;
+					seed = (seed ^ (seed >> 27)) * 0x94d049bb133111eb;
+					const query_map_hash hash{ (seed ^ (seed >> 31)) | 1, bits };
+
+					bool collision = false;
+					for (size_t i = 0; i < N && !collision; ++i)
+						for (size_t j = i + 1; j < N && !collision; ++j)
+							collision = hash(keys[i]) == hash(keys[j]);
+					if (!collision)
+						return hash;
+				}
+			}
+		}
+
+		template<class Derived, class Interface>
+		inline void *query_map_cast(Derived *pobject) noexcept
+		{
+			if constexpr (std::is_same_v<Interface, IUnknown>)
+				return pobject->GetUnknown();
+			else
+				return static_cast<Interface *>(pobject);
+		}
+
+		template<class Derived>
+		inline void *query_map_miss(Derived *) noexcept
+		{
+			return nullptr;
+		}
+
+		template<class Derived>
+		struct query_map_entry
+		{
+			query_map_key key;
+			void *(*cast)(Derived *) noexcept;
+		};
+
+		template<class Derived, class Interfaces>
+		struct query_map;
+
+		template<class Derived, class...Interfaces>
+		struct query_map<Derived, mpl::vector<Interfaces...>>
+		{
+			using entry = query_map_entry<Derived>;
+
+			static constexpr std::array<entry, sizeof...(Interfaces)> all{ { entry{ make_query_map_key(get_interface_guid(interface_wrapper<Interfaces>{})), &query_map_cast<Derived, Interfaces> }... } };
+
+			static constexpr bool is_duplicate(size_t index) noexcept
+			{
+				for (size_t i = 0; i < index; ++i)
+					if (all[i].key == all[index].key)
+						return true;
+				return false;
+			}
+
+			static constexpr size_t size = []() noexcept
+			{
+				size_t count = 0;
+				for (size_t i = 0; i < all.size(); ++i)
+					if (!is_duplicate(i))
+						++count;
+				return count;
+			}();
+
+			// The first of the duplicate IIDs wins, just like in the recursive fold
+			static constexpr auto entries = []() noexcept
+			{
+				std::array<entry, size> unique{};
+				size_t count = 0;
+				for (size_t i = 0; i < all.size(); ++i)
+					if (!is_duplicate(i))
+						unique[count++] = all[i];
+				return unique;
+			}();
+
+			static constexpr query_map_hash hash = []() noexcept
+			{
+				std::array<query_map_key, size> keys{};
+				for (size_t i = 0; i < size; ++i)
+					keys[i] = entries[i].key;
+				return find_query_map_hash(keys);
+			}();
+
+			// Empty slots have zero key (GUID_NULL) that maps to a cast that always fails
+			static constexpr auto slots = []() noexcept
+			{
+				std::array<entry, size_t{ 1 } << hash.bits> slots{};
+				for (auto &slot : slots)
+					slot.cast = &query_map_miss<Derived>;
+				for (const auto &e : entries)
+					slots[hash(e.key)] = e;
+				return slots;
+			}();
+
+			static void *find(Derived *pobject, const GUID &iid) noexcept
+			{
+				const auto key = make_query_map_key(iid);
+				const auto &slot = slots[hash(key)];
+				return slot.key == key ? slot.cast(pobject) : nullptr;
+			}
+		};
+
+		// Fallback fold that only visits dynamic entries
+		template<class T, class...Entries>
+		inline void *query_dynamic(T *pobj, const GUID &iid, mpl::vector<Entries...>) noexcept;
+
+		template<class Entry, class T>
+		inline void *query_dynamic_single([[maybe_unused]] T *pobj, [[maybe_unused]] const GUID &iid) noexcept
+		{
+			if constexpr (!query_map_traits<Entry>::dynamic)
+				return nullptr;
+			else if constexpr (has_static_query<Entry>)
+				return query_dynamic(pobj, iid, typename Entry::can_query::type{});
+			else
+				return Entry::query_self(pobj, iid);
+		}
+
+		template<class T, class...Entries>
+		inline void *query_dynamic(T *pobj, const GUID &iid, mpl::vector<Entries...>) noexcept
+		{
+			void *result{ nullptr };
+			static_cast<void>((... || (nullptr != (result = query_dynamic_single<Entries>(pobj, iid)))));
+			return result;
+		}
+
 		template<class T, class...Args>
 		concept has_legacy_final_construct = requires(T obj, Args &&...args)
 		{
@@ -308,7 +554,7 @@ namespace belt::com
 		using has_on_add_ref = has_on_add_ref_impl<T, void>;
 
 		template<class Derived>
-		class __declspec(empty_bases)contained_value final : public Derived
+		class BELT_EMPTY_BASES contained_value final : public Derived
 		{
 			IUnknown *pOuterUnknown;
 
@@ -340,9 +586,47 @@ namespace belt::com
 			}
 		};
 
-		struct ref_count_base
+		// Reference count policies
+		// Member names are prefixed to avoid clashes with names declared in Derived
+		// _rc_fetch_sub takes the object's IUnknown for policies that may need to release it later on another thread
+		// biased_ref_count_base is defined in impl/biased_ref_count.h
+		template<class Counter>
+		struct atomic_ref_count_base
 		{
-			std::atomic<int> _rc_refcount{};
+			std::atomic<Counter> _rc_refcount{};
+
+			Counter _rc_fetch_add() noexcept
+			{
+				return _rc_refcount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			Counter _rc_fetch_sub(IUnknown *) noexcept
+			{
+				// Writes made by other owners must be visible to the thread that destroys the object
+				return _rc_refcount.fetch_sub(1, std::memory_order_acq_rel);
+			}
+
+			void _rc_store(Counter value) noexcept
+			{
+				_rc_refcount.store(value, std::memory_order_relaxed);
+			}
+
+			Counter _rc_load() const noexcept
+			{
+				return _rc_refcount.load(std::memory_order_relaxed);
+			}
+
+			// Adds a reference unless the count is zero
+			bool _rc_try_add() noexcept
+			{
+				auto count = _rc_refcount.load(std::memory_order_relaxed);
+				do
+				{
+					if (count == 0)
+						return false;
+				} while (!_rc_refcount.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+				return true;
+			}
 
 			void safe_increment() noexcept
 			{
@@ -355,6 +639,134 @@ namespace belt::com
 			}
 		};
 
+		using ref_count_base = atomic_ref_count_base<int>;
+		using wide_ref_count_base = atomic_ref_count_base<int64_t>;
+
+		// Plain counter for objects that never leave their creating thread
+		struct single_threaded_ref_count_base
+		{
+			int _rc_refcount{};
+#if defined(_DEBUG)
+			std::thread::id _rc_owner{ std::this_thread::get_id() };
+
+			void _rc_check_owner() const noexcept
+			{
+				assert(_rc_owner == std::this_thread::get_id() && "Object with single-threaded reference count is used by a thread other than the one that created it!");
+			}
+#else
+			static void _rc_check_owner() noexcept
+			{
+			}
+#endif
+
+			int _rc_fetch_add() noexcept
+			{
+				_rc_check_owner();
+				return _rc_refcount++;
+			}
+
+			int _rc_fetch_sub(IUnknown *) noexcept
+			{
+				_rc_check_owner();
+				return _rc_refcount--;
+			}
+
+			void _rc_store(int value) noexcept
+			{
+				_rc_refcount = value;
+			}
+
+			bool _rc_try_add() noexcept
+			{
+				_rc_check_owner();
+				if (_rc_refcount == 0)
+					return false;
+				++_rc_refcount;
+				return true;
+			}
+
+			void safe_increment() noexcept
+			{
+				_rc_refcount += 10;
+			}
+
+			void safe_decrement() noexcept
+			{
+				_rc_refcount -= 10;
+			}
+		};
+
+		// ref_count_policy
+		template<class T>
+		concept has_ref_count_policy = requires
+		{
+			typename T::ref_count_policy_t;
+		};
+
+		template<class T>
+		struct ref_count_policy_impl
+		{
+			// ref_count_policy_t is ambiguous if more than one reference count trait is specified
+			static_assert(!std::is_base_of_v<ref_count_trait_t, T>, "Only one reference count trait may be specified");
+			using type = ref_count_base;
+		};
+
+		template<has_ref_count_policy T>
+		struct ref_count_policy_impl<T>
+		{
+			using type = typename T::ref_count_policy_t;
+		};
+
+		template<class T>
+		using ref_count_policy = typename ref_count_policy_impl<T>::type;
+
+		// pooled
+		template<class T>
+		concept has_pooled = requires
+		{
+			typename T::pooled_t;
+			requires std::same_as<typename T::pooled_t, pooled_t>;
+		};
+
+		struct default_allocation {};
+
+		template<class T>
+		using allocation_base = std::conditional_t<has_pooled<T>, pool::pooled_allocation<T>, default_allocation>;
+
+		// collects_cycles
+		template<class T>
+		concept has_collects_cycles = requires
+		{
+			typename T::collects_cycles_t;
+			requires std::same_as<typename T::collects_cycles_t, collects_cycles_t>;
+		};
+
+		template<class T>
+		concept has_traverse = requires(T &obj, cycle_visitor &visitor)
+		{
+			obj.traverse(visitor);
+		};
+
+		template<class T>
+		concept has_load_ref_count = requires(const T &refcount)
+		{
+			refcount._rc_load();
+		};
+
+		template<class T>
+		using cycle_node_base = std::conditional_t<has_collects_cycles<T>, cycle_node, no_cycle_node>;
+
+		// deferred_destruction
+		template<class T>
+		concept has_deferred_destruction = requires
+		{
+			typename T::deferred_destruction_t;
+			requires std::same_as<typename T::deferred_destruction_t, deferred_destruction_t>;
+		};
+
+		template<class T>
+		using deferred_node_base = std::conditional_t<has_deferred_destruction<T>, deferred_node, no_deferred_node>;
+
 #if defined(_DEBUG)
 		using no_count_base = ref_count_base;
 #else
@@ -373,9 +785,6 @@ namespace belt::com
 		template<class Enabled>
 		struct usage_map_base
 		{
-			static void add_cookie() noexcept
-			{}
-
 			static void remove_cookie() noexcept
 			{}
 		};
@@ -384,20 +793,15 @@ namespace belt::com
 		template<>
 		struct usage_map_base<std::true_type>
 		{
-			std::vector<leak_detection *> umb_usages;
-			belt::srwlock umb_lock;
+			// Number of outstanding records for this object, records themselves are kept in the global leak table
+			std::atomic<int> umb_outstanding{};
 
-			void add_cookie() noexcept
+			void add_cookie(std::string_view class_name) noexcept
 			{
 				try
 				{
-					auto cookie = new leak_detection;
-
-					{
-						std::scoped_lock l{ umb_lock };
-						umb_usages.emplace_back(cookie);
-					}
-					set_current_cookie(cookie->ordinal);
+					set_current_cookie(get_leak_table().insert(this, class_name));
+					umb_outstanding.fetch_add(1, std::memory_order_relaxed);
 				}
 				catch (...)
 				{
@@ -406,34 +810,18 @@ namespace belt::com
 
 			void remove_cookie() noexcept
 			{
-				try
-				{
-					auto cookie = get_current_cookie();
-					if (cookie)
-					{
-						std::scoped_lock l{ umb_lock };
-						auto it = std::find_if(umb_usages.begin(), umb_usages.end(), [cookie](auto * leak)
-							{
-								return leak->ordinal == cookie;
-							});
-						if (umb_usages.end() != it)
-						{
-							delete *it;
-							umb_usages.erase(it);
-						}
-						else
-							assert(false && "Cookie is not found in a map");
-					}
-				}
-				catch (...)
+				if (auto cookie = get_current_cookie())
 				{
+					[[maybe_unused]] auto found = get_leak_table().erase(cookie, this);
+					assert(found && "Cookie is not found in a map");
+					umb_outstanding.fetch_sub(1, std::memory_order_relaxed);
 				}
 			}
 		};
 #endif
 
 		template<class Derived, class Base>
-		struct __declspec(empty_bases) final_construct_support : Base, usage_map_base<has_enable_leak_detector<Derived>>
+		struct BELT_EMPTY_BASES final_construct_support : Base, usage_map_base<has_enable_leak_detector<Derived>>
 		{
 			template<class...Args>
 			void do_final_construct([[maybe_unused]] Derived &obj, [[maybe_unused]] Args &&...args)
@@ -452,12 +840,12 @@ namespace belt::com
 			}
 
 			template<class Holder>
-			static void do_final_release(std::unique_ptr<Holder> obj, [[maybe_unused]] std::atomic<int> &refcount) noexcept
+			static void do_final_release(std::unique_ptr<Holder> obj, [[maybe_unused]] Base &refcount) noexcept
 			{
 				static_assert(!has_legacy_final_release<Derived>, "Legacy FinalRelease no longer supported. Use new style final_release instead");
 				if constexpr (has_final_release<Derived, Holder>)
 				{
-					refcount.store(1, std::memory_order_relaxed);	// allow for safe QueryInterface for an overloaded final_release function
+					refcount._rc_store(1);	// allow for safe QueryInterface for an overloaded final_release function
 					Derived::final_release(std::move(obj));
 				}
 				else
@@ -481,7 +869,13 @@ namespace belt::com
 
 			void debug_on_add_ref(const Derived &obj, int value) noexcept
 			{
-				usage_map_base<has_enable_leak_detector<Derived>>::add_cookie();
+#if BELT_HAS_LEAK_SAMPLING
+				sampling::sampler<Derived>::on_add_ref(&obj);
+#endif
+#if BELT_HAS_LEAK_DETECTION
+				if constexpr (has_enable_leak_detector<Derived>::value)
+					usage_map_base<std::true_type>::add_cookie(leak_class_name<Derived>);
+#endif
 				debug_on_add_ref(obj, value, has_on_add_ref<Derived>{});
 			}
 
@@ -497,40 +891,45 @@ namespace belt::com
 
 			void debug_on_release(const Derived &obj, int value) noexcept
 			{
+#if BELT_HAS_LEAK_SAMPLING
+				if (auto cookie = get_current_cookie()) [[unlikely]]
+					sampling::forget(cookie, &obj);
+#endif
 				usage_map_base<has_enable_leak_detector<Derived>>::remove_cookie();
 				debug_on_release(obj, value, has_on_release<Derived>{});
 			}
 		};
 
 		template<class Derived>
-		class __declspec(empty_bases)aggvalue final: public final_construct_support<Derived, ref_count_base>, public IUnknown
+		class BELT_EMPTY_BASES aggvalue final: public final_construct_support<Derived, ref_count_policy<Derived>>, public IUnknown, public allocation_base<Derived>
 		{
 			contained_value<Derived> object;
 
-			using final_construct_support<Derived, ref_count_base>::_rc_refcount;
-
 		public:
 			template<class...Args>
 			aggvalue(IUnknown *pOuterUnknown, Args &&...args) :
 				object{ pOuterUnknown, std::forward<Args>(args)... }
 			{
 				static_assert(!has_final_release<Derived> || has_final_release<Derived, aggvalue<Derived>>, "Class overrides final_release, but does not work with aggregate values. Consider taking templated holder if your object can be aggregated.");
+				static_assert(!std::is_same_v<ref_count_policy<Derived>, weak_ref_count_base>, "Objects that support weak references cannot be aggregated");
+				static_assert(!has_collects_cycles<Derived>, "Objects that collect cycles cannot be aggregated");
+				static_assert(!has_deferred_destruction<Derived>, "Objects with deferred destruction cannot be aggregated");
 				this->do_final_construct(object);
 			}
 
 			virtual ULONG STDMETHODCALLTYPE AddRef() noexcept override
 			{
-				return _rc_refcount.fetch_add(1, std::memory_order_relaxed) + 1;
+				return static_cast<ULONG>(this->_rc_fetch_add() + 1);
 			}
 
 			virtual ULONG STDMETHODCALLTYPE Release() noexcept override
 			{
-				auto prev = _rc_refcount.fetch_sub(1, std::memory_order_relaxed);
+				auto prev = this->_rc_fetch_sub(this);
 				if (prev == 1)
 				{
-					this->do_final_release(std::unique_ptr<aggvalue>{this}, _rc_refcount);
+					this->do_final_release(std::unique_ptr<aggvalue>{this}, *this);
 				}
-				return prev - 1;
+				return static_cast<ULONG>(prev - 1);
 			}
 
 			virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) noexcept override
@@ -555,62 +954,230 @@ namespace belt::com
 		};
 
 		template<class DerivedNonMatchingName>
-		class __declspec(empty_bases)value : public DerivedNonMatchingName, public final_construct_support<DerivedNonMatchingName, ref_count_base>
+		class BELT_EMPTY_BASES value : public DerivedNonMatchingName, public final_construct_support<DerivedNonMatchingName, ref_count_policy<DerivedNonMatchingName>>, public allocation_base<DerivedNonMatchingName>, public cycle_node_base<DerivedNonMatchingName>, public deferred_node_base<DerivedNonMatchingName>
 		{
+			// Objects of classes with collects_cycles trait are tracked from the end of final_construct until their reference
+			// count drops to zero
+			void track_cycles() noexcept
+			{
+				if constexpr (has_collects_cycles<DerivedNonMatchingName>)
+				{
+					static_assert(has_traverse<DerivedNonMatchingName>, "Class with collects_cycles trait must implement traverse(cycle_visitor &) method");
+					static_assert(has_load_ref_count<ref_count_policy<DerivedNonMatchingName>>, "Reference count policy of a class with collects_cycles trait must support _rc_load");
+
+					static constexpr cycle_class type
+					{
+						type_name<DerivedNonMatchingName>(),
+						sizeof(value),
+						[](cycle_node *node) noexcept
+						{
+							return static_cast<value *>(node)->_rc_try_add();
+						},
+						[](cycle_node *node) noexcept
+						{
+							// The reference added by pin is not seen by leak detection and is released the same way
+							auto object = static_cast<value *>(node);
+							if (object->_rc_fetch_sub(object->GetUnknown()) == 1)
+								object->final_release_tracked();
+						},
+						[](const cycle_node *node) noexcept
+						{
+							return static_cast<size_t>(static_cast<const value *>(node)->_rc_load());
+						},
+						[](cycle_node *node, cycle_visitor &visitor)
+						{
+							static_cast<value *>(node)->traverse(visitor);
+						},
+						[](cycle_node *node) noexcept
+						{
+							return static_cast<value *>(node)->GetUnknown();
+						},
+					};
+					get_cycle_registry().track(this, &type);
+				}
+			}
+
+			void untrack_cycles() noexcept
+			{
+				if constexpr (has_collects_cycles<DerivedNonMatchingName>)
+					get_cycle_registry().untrack(this);
+			}
+
+			// final_release may set the reference count back to one, the object must not be found by the collector then
+			void final_release_tracked() noexcept
+			{
+				untrack_cycles();
+				final_release_value();
+			}
+
+		protected:
+			// Objects of classes with deferred_destruction trait are queued to the reclaimer
+			void final_release_value() noexcept
+			{
+				if constexpr (has_deferred_destruction<DerivedNonMatchingName>)
+				{
+					get_reclaimer().push(this, [](deferred_node *node) noexcept
+					{
+						auto &object = static_cast<value &>(*node);
+						value::do_final_release(std::unique_ptr<DerivedNonMatchingName>{ &object }, object);
+					});
+				}
+				else
+					this->do_final_release(std::unique_ptr<DerivedNonMatchingName>{ this }, *this);
+			}
+
 		public:
-			virtual ~value() = default;
+			virtual ~value()
+			{
+				untrack_cycles();
+			}
+
 			value(const value &o) :
 				DerivedNonMatchingName{ static_cast<const DerivedNonMatchingName &>(o) }
 			{
 				this->do_final_construct(*this);
+				track_cycles();
 			}
 
 			template<class...Args>
 			value(Args &&...args) : DerivedNonMatchingName{ std::forward<Args>(args)... }
 			{
 				this->do_final_construct(*this);
+				track_cycles();
 			}
 
 			template<class...Args>
 			value(delayed_t, Args &&...args)
 			{
 				this->do_final_construct(*this, std::forward<Args>(args)...);
+				track_cycles();
 			}
 
 			virtual ULONG STDMETHODCALLTYPE AddRef() noexcept override
 			{
-				auto ret = this->_rc_refcount.fetch_add(1, std::memory_order_relaxed) + 1;
-				this->debug_on_add_ref(*static_cast<const DerivedNonMatchingName *>(this), ret);
-				return ret;
+				auto ret = this->_rc_fetch_add() + 1;
+				this->debug_on_add_ref(*static_cast<const DerivedNonMatchingName *>(this), static_cast<int>(ret));
+				return static_cast<ULONG>(ret);
 			}
 
 			virtual ULONG STDMETHODCALLTYPE Release() noexcept override
 			{
-				auto prev = this->_rc_refcount.fetch_sub(1, std::memory_order_relaxed);
-				this->debug_on_release(*static_cast<const DerivedNonMatchingName *>(this), prev);
+				auto prev = this->_rc_fetch_sub(this->GetUnknown());
+				this->debug_on_release(*static_cast<const DerivedNonMatchingName *>(this), static_cast<int>(prev));
 
 				if (prev == 1)
 				{
-					this->do_final_release(std::unique_ptr<DerivedNonMatchingName>{ this }, this->_rc_refcount);
+					final_release_tracked();
 				}
 
-				return prev - 1;
+				return static_cast<ULONG>(prev - 1);
 			}
 		};
 
+		template<class T>
+		concept has_try_add_ref = requires(T &refcount)
+		{
+			{ refcount._rc_try_add() } -> std::same_as<bool>;
+		};
+
+		// Cached instance of a class with single_cached_instance trait. Requests for an alive instance take the lock shared
+		// and add a reference only if the reference count has not yet dropped to zero. The lock is taken exclusively to
+		// create a new instance and by an instance whose reference count dropped to zero, to unpublish itself before it is
+		// destroyed
 		template<class DerivedNonMatchingName>
-		class __declspec(empty_bases)smart_singleton_value final : public value<DerivedNonMatchingName>
+		class BELT_EMPTY_BASES smart_singleton_value final : public value<DerivedNonMatchingName>
 		{
-			std::shared_ptr<DerivedNonMatchingName> self{ static_cast<DerivedNonMatchingName *>(this), [](auto *) {} };
+			static_assert(has_try_add_ref<ref_count_policy<DerivedNonMatchingName>>, "Reference count policy of a class with single_cached_instance trait must support _rc_try_add");
+			static_assert(!has_collects_cycles<DerivedNonMatchingName>, "Classes with single_cached_instance trait cannot collect cycles");
+
+			static inline srwlock lock;
+			static inline smart_singleton_value *current{};
+
+			// Returns the current instance with an added reference, or nullptr. An instance whose reference count dropped to
+			// zero is being destroyed and is not revived
+			static smart_singleton_value *acquire_current() noexcept
+			{
+				return current && current->_rc_try_add() ? current : nullptr;
+			}
+
+			void final_release_cached() noexcept
+			{
+				{
+					std::scoped_lock l{ lock };
+					if (current == this)
+						current = nullptr;
+				}
+				this->final_release_value();
+			}
+
 		public:
-			std::weak_ptr<DerivedNonMatchingName> get_weak() const noexcept
+			static HRESULT create(const GUID &iid, void **ppv)
+			{
+				smart_singleton_value *instance;
+				{
+					std::shared_lock l{ lock };
+					instance = acquire_current();
+				}
+
+				if (!instance)
+				{
+					std::scoped_lock l{ lock };
+					instance = acquire_current();
+					if (!instance)
+					{
+						auto object = std::make_unique<smart_singleton_value>();
+						auto hr = object->QueryInterface(iid, ppv);
+						if (SUCCEEDED(hr))
+							current = object.release();
+						return hr;
+					}
+				}
+
+				// The reference taken by acquire_current is not seen by leak detection and is released the same way
+				auto hr = instance->QueryInterface(iid, ppv);
+				if (instance->_rc_fetch_sub(instance->GetUnknown()) == 1)
+					instance->final_release_cached();
+				return hr;
+			}
+
+			virtual ULONG STDMETHODCALLTYPE Release() noexcept override
+			{
+				auto prev = this->_rc_fetch_sub(this->GetUnknown());
+				this->debug_on_release(*static_cast<const DerivedNonMatchingName *>(this), static_cast<int>(prev));
+
+				if (prev == 1)
+					final_release_cached();
+
+				return static_cast<ULONG>(prev - 1);
+			}
+		};
+
+		// Object placed in a caller-supplied memory resource. Its memory is not freed when the reference count reaches zero,
+		// it is reclaimed with the resource
+		template<class DerivedNonMatchingName>
+		class BELT_EMPTY_BASES arena_value final : public value<DerivedNonMatchingName>
+		{
+		public:
+			using value<DerivedNonMatchingName>::value;
+
+			static void *operator new(size_t size, std::pmr::memory_resource &resource)
+			{
+				return resource.allocate(size, alignof(arena_value));
+			}
+
+			// Called if constructor throws
+			static void operator delete(void *p, std::pmr::memory_resource &resource) noexcept
+			{
+				resource.deallocate(p, sizeof(arena_value), alignof(arena_value));
+			}
+
+			static void operator delete(void *) noexcept
 			{
-				return self;
 			}
 		};
 
 		template<class Derived>
-		class __declspec(empty_bases)value_on_stack : public Derived, public final_construct_support<Derived, no_count_base>
+		class BELT_EMPTY_BASES value_on_stack : public Derived, public final_construct_support<Derived, no_count_base>
 		{
 		public:
 			value_on_stack(const value_on_stack &) = delete;
@@ -620,6 +1187,8 @@ namespace belt::com
 			value_on_stack(Args &&...args) : Derived{ std::forward<Args>(args)... }
 			{
 				static_assert(!has_final_release<Derived>, "Classes with final_release cannot be used on stack");
+				static_assert(!std::is_same_v<ref_count_policy<Derived>, weak_ref_count_base>, "Objects that support weak references cannot be used on stack");
+				static_assert(!has_collects_cycles<Derived>, "Objects that collect cycles cannot be used on stack");
 				this->do_final_construct(*this);
 			}
 
@@ -627,6 +1196,8 @@ namespace belt::com
 			value_on_stack(delayed_t, Args &&...args)
 			{
 				static_assert(!has_final_release<Derived>, "Classes with final_release cannot be used on stack");
+				static_assert(!std::is_same_v<ref_count_policy<Derived>, weak_ref_count_base>, "Objects that support weak references cannot be used on stack");
+				static_assert(!has_collects_cycles<Derived>, "Objects that collect cycles cannot be used on stack");
 				this->do_final_construct(*this, std::forward<Args>(args)...);
 			}
 
@@ -712,6 +1283,15 @@ namespace belt::com
 				return value.release()->GetUnknown();
 			}
 
+			template<class Interface>
+			static Interface *cast(T *object) noexcept
+			{
+				if constexpr (std::is_same_v<IUnknown, Interface>)
+					return object->GetUnknown();
+				else
+					return static_cast<Interface *>(object);
+			}
+
 		public:
 			object_holder(std::unique_ptr<T> &&value) noexcept :
 				value{ std::move(value) }
@@ -725,7 +1305,21 @@ namespace belt::com
 
 			auto to_ptr() && noexcept
 			{
-				return std::move(*this).to_ptr<typename T::DefaultInterface>();
+				return std::move(*this).template to_ptr<typename T::DefaultInterface>();
+			}
+
+			// All interfaces are obtained with static casts, the result never calls QueryInterface
+			template<class Primary, class...Others>
+			multi_ptr<Primary, Others...> to_multi_ptr() && noexcept
+			{
+				static_assert(((std::is_convertible_v<T *, Others *> || std::is_same_v<IUnknown, Others>) && ...), "Object does not implement all interfaces");
+				if constexpr (sizeof...(Others) == 0)
+					return std::move(*this).template to_ptr<Primary>();
+				else
+				{
+					auto object = value.get();
+					return { std::move(*this).template to_ptr<Primary>(), cast<Others>(object)... };
+				}
 			}
 
 			T *obj() const noexcept
@@ -740,7 +1334,7 @@ namespace belt::com
 		};
 
 		template<class Derived, class FirstInterface, class...OtherInterfaces>
-		class __declspec(empty_bases)object : public extends_base<FirstInterface, OtherInterfaces...>
+		class BELT_EMPTY_BASES object : public extends_base<FirstInterface, OtherInterfaces...>
 		{
 			using fint_t = decltype(details::get_first(interface_wrapper<FirstInterface>{}));
 			using FirstRealInterface = typename fint_t::type;
@@ -790,27 +1384,41 @@ namespace belt::com
 			virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) noexcept override
 			{
 				auto *pobject = static_cast<Derived *>(this);
+				if constexpr (std::is_same_v<ref_count_policy<Derived>, weak_ref_count_base>)
+				{
+					if (riid == weak_control_block_id)
+					{
+						auto block = static_cast<value<Derived> *>(pobject)->_rc_block;
+						if constexpr (has_on_add_ref<Derived>::value)
+							block->set_observed();
+						block->add_weak();
+						*ppvObject = block;
+						return S_OK;
+					}
+				}
+
 				auto hr = pobject->pre_query_interface(riid, ppvObject);
 				if (SUCCEEDED(hr) || hr != E_NOINTERFACE)
 					return hr;
 
-				if (riid == get_interface_guid(interface_wrapper<IUnknown>{}))
+				if (auto result = query_map<Derived, mpl::join_t<mpl::vector<IUnknown>, query_map_interfaces_t<FirstInterface, OtherInterfaces...>>>::find(pobject, riid))
 				{
-					auto pUnk = pobject->GetUnknown();
-					*ppvObject = pUnk;
-					pUnk->AddRef();
+					*ppvObject = result;
+					pobject->GetUnknown()->AddRef();
 					return S_OK;
 				}
 
-				auto result = this->query_children(pobject, riid);
-				if (result)
+				if constexpr (query_map_dynamic_v<FirstInterface, OtherInterfaces...>)
 				{
-					// AddRef has already been called
-					*ppvObject = result;
-					return S_OK;
+					if (auto result = query_dynamic(pobject, riid, mpl::vector<FirstInterface, OtherInterfaces...>{}))
+					{
+						// AddRef has already been called
+						*ppvObject = result;
+						return S_OK;
+					}
 				}
-				else
-					return pobject->post_query_interface(riid, ppvObject);
+
+				return pobject->post_query_interface(riid, ppvObject);
 			}
 
 			// Instance creation
@@ -821,6 +1429,15 @@ namespace belt::com
 				return { std::make_unique<value<Derived>>(std::forward<Args>(args)...) };
 			}
 
+			// Place the object in the given memory resource, for example, std::pmr::monotonic_buffer_resource. All references
+			// must be released before the resource is destroyed
+			template<class...Args>
+			static object_holder<arena_value<Derived>> create_instance_in(std::pmr::memory_resource &arena, Args &&...args)
+			{
+				static_assert(!check_trait<has_smart_singleton_factory>(), "Objects marked as single_cached_instance (AKA smart_singleton_factory) cannot be currently created using create_instance_in method");
+				return { std::unique_ptr<arena_value<Derived>>{ new (arena) arena_value<Derived>(std::forward<Args>(args)...) } };
+			}
+
 			template<class...Args>
 			static com_ptr<IUnknown> create_aggregate(IUnknown *pOuterUnknown, Args &&...args)
 			{
@@ -847,6 +1464,19 @@ namespace belt::com
 			{
 				return static_cast<value<Derived> *>(this)->Release();
 			}
+
+			// biased_ref_count only: move owner thread's references to the shared counter before the object is passed to other threads
+			void hand_off() noexcept
+			{
+				static_cast<value<Derived> *>(this)->_rc_hand_off();
+			}
+
+			// collects_cycles only: must be called in the same critical section as every change of the members reported by traverse
+			void members_changed() noexcept
+			{
+				static_assert(has_collects_cycles<Derived>, "members_changed may only be called by classes with collects_cycles trait");
+				static_cast<value<Derived> *>(this)->_cc_epoch.fetch_add(1, std::memory_order_release);
+			}
 		};
 
 		template<class Derived, class FirstInterface, class...OtherInterfaces>
@@ -860,23 +1490,13 @@ namespace belt::com
 					if constexpr (check_trait<has_singleton_factory>())
 					{
 						static_assert(!has_final_release<Derived>, "Singleton classes are not compatible with final_release");
+						// Only the first call is synchronized, later calls check the initialization guard with a single load
 						static value_on_stack<Derived> single_value;
 						hr = single_value.QueryInterface(iid, ppv);
 					}
 					else if constexpr (check_trait<has_smart_singleton_factory>())
 					{
-						static srwlock init_lock;
-						static std::weak_ptr<Derived> current_instance;
-						std::scoped_lock l{ init_lock };
-						if (auto instance = current_instance.lock())
-							return instance->QueryInterface(iid, ppv);
-						else
-						{
-							auto object=std::make_unique<smart_singleton_value<Derived>>();
-							hr = object->QueryInterface(iid, ppv);
-							if (SUCCEEDED(hr))
-								current_instance = object.release()->get_weak();
-						}
+						hr = smart_singleton_value<Derived>::create(iid, ppv);
 					}
 					else
 					{
@@ -921,29 +1541,20 @@ namespace belt::com
 #pragma endregion
 
 #pragma region Auto factory support
-		using create_function_t = HRESULT(*)(const GUID &iid, void **ppv, IUnknown *) noexcept;
-		struct _OBJMAP_ENTRY
-		{
-			GUID clsid;
-			create_function_t create;
-		};
-
-#pragma section("BIS$__a", read)
-#pragma section("BIS$__z", read)
-#pragma section("BIS$__b", read)
-		extern "C"
+		BELT_MODULE_LOCAL inline HRESULT create_object(const GUID &clsid, const GUID &iid, void **ppv, IUnknown *pOuterUnknown = nullptr) noexcept
 		{
-			__declspec(selectany) __declspec(allocate("BIS$__a")) _OBJMAP_ENTRY* __pobjObjEntryFirst = nullptr;
-			__declspec(selectany) __declspec(allocate("BIS$__z")) _OBJMAP_ENTRY* __pobjObjEntryLast = nullptr;
-		}
-
-		inline HRESULT create_object(const GUID &clsid, const GUID &iid, void **ppv, IUnknown *pOuterUnknown = nullptr) noexcept
-		{
-			for (auto p = &__pobjObjEntryFirst + 1; p < &__pobjObjEntryLast; ++p)
+			const class_registry *registry;
+			try
 			{
-				if (*p && (*p)->clsid == clsid)
-					return (*p)->create(iid, ppv, pOuterUnknown);
+				registry = &get_class_registry();
 			}
+			catch (...)
+			{
+				return E_OUTOFMEMORY;
+			}
+
+			if (auto entry = registry->find(clsid))
+				return entry->create(iid, ppv, pOuterUnknown);
 			return REGDB_E_CLASSNOTREG;
 		}
 
@@ -976,34 +1587,99 @@ namespace belt::com
 	using details::eats_all;
 	using details::also;
 	using details::create_object;
+	using details::registered_class;
+	using details::class_registry_stats;
+	using details::get_registered_classes;
+	using details::get_class_registry_stats;
 	using details::delayed;
 	using details::value_on_stack;
 	using details::interface_wrapper;
-
-	struct __declspec(empty_bases)singleton_factory
+	using details::cycle_visitor;
+	using details::cycle_class_stats;
+	using details::cycle_collection;
+	using details::collect_cycles;
+	using details::cycle_collector_thread;
+	using details::deferred_stats;
+	using details::drain_deferred;
+	using details::set_deferred_capacity;
+	using details::get_deferred_stats;
+	using details::reclaimer_thread;
+
+	struct BELT_EMPTY_BASES singleton_factory
 	{
 		using singleton_factory_t = details::singleton_factory_t;
 	};
 
-	struct __declspec(empty_bases)single_cached_instance
+	struct BELT_EMPTY_BASES single_cached_instance
 	{
 		using smart_singleton_factory_t = details::smart_singleton_factory_t;
 	};
 
-	struct __declspec(empty_bases)supports_aggregation
+	struct BELT_EMPTY_BASES supports_aggregation
 	{
 		using supports_aggregation_t = details::supports_aggregation_t;
 	};
 
-	struct __declspec(empty_bases)increments_module_count
+	struct BELT_EMPTY_BASES increments_module_count
 	{
 		using increments_module_count_t = details::increments_module_count_t;
 	};
 
-	struct __declspec(empty_bases)enable_leak_detection
+	struct BELT_EMPTY_BASES enable_leak_detection
 	{
 		using enable_leak_detection_t = details::enable_leak_detection_t;
 	};
+
+	struct BELT_EMPTY_BASES single_threaded_ref_count : public details::ref_count_trait_t
+	{
+		using ref_count_policy_t = details::single_threaded_ref_count_base;
+	};
+
+	struct BELT_EMPTY_BASES wide_ref_count : public details::ref_count_trait_t
+	{
+		using ref_count_policy_t = details::wide_ref_count_base;
+	};
+
+	struct BELT_EMPTY_BASES biased_ref_count : public details::ref_count_trait_t
+	{
+		using ref_count_policy_t = details::biased_ref_count_base;
+	};
+
+	struct BELT_EMPTY_BASES supports_weak_references : public details::ref_count_trait_t
+	{
+		using ref_count_policy_t = details::weak_ref_count_base;
+	};
+
+	struct BELT_EMPTY_BASES pooled
+	{
+		using pooled_t = details::pooled_t;
+	};
+
+	struct BELT_EMPTY_BASES collects_cycles
+	{
+		using collects_cycles_t = details::collects_cycles_t;
+	};
+
+	struct BELT_EMPTY_BASES deferred_destruction
+	{
+		using deferred_destruction_t = details::deferred_destruction_t;
+	};
+
+	// Pre-size the pool used by heap instances of pooled class Derived so that at least count objects can be created
+	// without allocating memory from the system
+	template<class Derived>
+	inline void reserve_pool(size_t count)
+	{
+		details::pool::reserve(sizeof(details::value<Derived>), count);
+	}
+
+	// Merge objects with biased_ref_count owned by the calling thread whose references have been released by other threads.
+	// Threads do it automatically on each Release call and on exit; long-idle owner threads may call it explicitly
+	inline void merge_biased_ref_counts() noexcept
+	{
+		if (auto owner = details::biased_owner::current())
+			owner->drain();
+	}
 }
 
 #define BELT_CLASS_GUID(id) static constexpr auto get_guid() noexcept { constexpr auto guid = belt::com::make_guid(id); return guid; }
@@ -1020,14 +1696,16 @@ inline constexpr auto get_guid(name *) noexcept { return msvc_get_guid_workaroun
 // The following macro keeps __declspec(uuid()) for backward compatibility
 #define BELT_DEFINE_INTERFACE(name, id) \
 _BELT_GUID_HELPER(name, id) \
-struct __declspec(novtable) __declspec(empty_bases) __declspec(uuid(id)) name : belt::com::extends<name, IUnknown> \
+struct BELT_NOVTABLE BELT_EMPTY_BASES BELT_UUID(id) name : belt::com::extends<name, IUnknown> \
 // end of macro
 
 #define BELT_DEFINE_INTERFACE_BASE(name,base,id) \
 _BELT_GUID_HELPER(name, id) \
-struct __declspec(novtable) __declspec(empty_bases) __declspec(uuid(id)) name : belt::com::extends<name, base> \
+struct BELT_NOVTABLE BELT_EMPTY_BASES BELT_UUID(id) name : belt::com::extends<name, base> \
 // end of macro
 
+#if defined(_MSC_VER)
+
 #if !defined(_M_IA64)
 #pragma comment(linker, "/merge:BIS=.rdata")
 #endif
@@ -1044,21 +1722,42 @@ struct __declspec(novtable) __declspec(empty_bases) __declspec(uuid(id)) name :
 
 #endif
 
+#define BELT_OBJ_ENTRY_SECTION __declspec(allocate("BIS$__b")) __declspec(selectany)
+
+#else
+
+// "used" and "retain" keep the entry from being discarded by the compiler and by linker's garbage collection
+#if defined(__has_attribute)
+#if __has_attribute(retain)
+#define BELT_OBJ_ENTRY_SECTION __attribute__((section("belt_objmap"), used, retain))
+#endif
+#endif
+
+#ifndef BELT_OBJ_ENTRY_SECTION
+#define BELT_OBJ_ENTRY_SECTION __attribute__((section("belt_objmap"), used))
+#endif
+
+#ifndef BELT_OBJ_ENTRY_PRAGMA
+#define BELT_OBJ_ENTRY_PRAGMA(class)
+#endif
+
+#endif
+
 #define BELT_OBJ_ENTRY_AUTO(class) \
 	const belt::com::details::_OBJMAP_ENTRY __objxMap_##class = {belt::com::get_interface_guid<class>(), &class::factory_create_object}; \
-	extern "C" __declspec(allocate("BIS$__b")) __declspec(selectany) const belt::com::details::_OBJMAP_ENTRY* const __p2objMap_##class = &__objxMap_##class; \
+	extern "C" BELT_OBJ_ENTRY_SECTION const belt::com::details::_OBJMAP_ENTRY* const __p2objMap_##class = &__objxMap_##class; \
 	BELT_OBJ_ENTRY_PRAGMA(class) \
 	// end of macro
 
 #define BELT_OBJ_ENTRY_AUTO2(clsid, class) \
 	const belt::com::details::_OBJMAP_ENTRY __objxMap_##class = {clsid, &class::factory_create_object}; \
-	extern "C" __declspec(allocate("BIS$__b")) __declspec(selectany) const belt::com::details::_OBJMAP_ENTRY* const __p2objMap_##class = &__objxMap_##class; \
+	extern "C" BELT_OBJ_ENTRY_SECTION const belt::com::details::_OBJMAP_ENTRY* const __p2objMap_##class = &__objxMap_##class; \
 	BELT_OBJ_ENTRY_PRAGMA(class) \
 	// end of macro
 
 #define BELT_OBJ_ENTRY_AUTO2_NAMED(clsid, class, name) \
 	const belt::com::details::_OBJMAP_ENTRY __objxMap_##class##name = {clsid, &class::factory_create_object}; \
-	extern "C" __declspec(allocate("BIS$__b")) __declspec(selectany) const belt::com::details::_OBJMAP_ENTRY* const __p2objMap_##class##name = &__objxMap_##class##name; \
+	extern "C" BELT_OBJ_ENTRY_SECTION const belt::com::details::_OBJMAP_ENTRY* const __p2objMap_##class##name = &__objxMap_##class##name; \
 	BELT_OBJ_ENTRY_PRAGMA(class##name) \
 	// end of macro
 
@@ -15,21 +15,22 @@ namespace belt::com
 {
 	namespace details
 	{
-		class __declspec(novtable) Factory :
+		// Class factories are cached per class and are not reference counted
+		class BELT_NOVTABLE Factory :
 			public object<
 			Factory,
 			IClassFactory
 			>
 		{
-			CLSID classId;
+			create_function_t create;
 		public:
-			Factory(const CLSID &classId) noexcept :
-				classId{ classId }
+			Factory(create_function_t create) noexcept :
+				create{ create }
 			{}
 
 			virtual HRESULT STDMETHODCALLTYPE CreateInstance(IUnknown *pUnkOuter, REFIID riid, void **ppvObject) noexcept override
 			{
-				return belt::com::create_object(classId, riid, ppvObject, pUnkOuter);
+				return create(riid, ppvObject, pUnkOuter);
 			}
 
 			virtual HRESULT STDMETHODCALLTYPE LockServer(BOOL fLock) noexcept override
@@ -42,13 +43,63 @@ namespace belt::com
 				return S_OK;
 			}
 		};
+
+		// A factory for each class of the module registry, created on first request. Concurrent first requests may create
+		// several factories, all but the one that is published first are discarded
+		class factory_cache
+		{
+			using factory_t = value_on_stack<Factory>;
+
+			const class_registry &registry;
+			std::unique_ptr<std::atomic<factory_t *>[]> factories;
+
+		public:
+			factory_cache() :
+				registry{ get_class_registry() },
+				factories{ new std::atomic<factory_t *>[registry.size()]{} }
+			{}
+
+			IClassFactory *get(const registered_class &entry)
+			{
+				auto &slot = factories[registry.index_of(&entry)];
+				auto factory = slot.load(std::memory_order_acquire);
+				if (!factory) [[unlikely]]
+				{
+					auto created = std::make_unique<factory_t>(entry.create);
+					if (slot.compare_exchange_strong(factory, created.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+						factory = created.release();
+				}
+				return factory;
+			}
+		};
+
+		// Never destroyed, clients may keep references to factories
+		BELT_MODULE_LOCAL inline factory_cache &get_factory_cache()
+		{
+			static auto *cache = new factory_cache;
+			return *cache;
+		}
 	}
 
-	inline HRESULT DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID* ppv) noexcept
+	BELT_MODULE_LOCAL inline HRESULT DllGetClassObject(REFCLSID rclsid, REFIID riid, LPVOID* ppv) noexcept
 	{
+		if (!ppv)
+			return E_POINTER;
+		*ppv = nullptr;
+
 		try
 		{
-			auto factory = details::Factory::create_instance(rclsid).to_ptr<IUnknown>();
+			auto entry = details::get_class_registry().find(rclsid);
+			if (!entry)
+				return CLASS_E_CLASSNOTAVAILABLE;
+			auto factory = details::get_factory_cache().get(*entry);
+			// Skip QueryInterface for the interface requested by COM, AddRef of a cached factory does nothing in release builds
+			if (riid == get_interface_guid<IClassFactory>())
+			{
+				factory->AddRef();
+				*ppv = factory;
+				return S_OK;
+			}
 			return factory->QueryInterface(riid, ppv);
 		}
 		catch (const std::bad_alloc &)
@@ -0,0 +1,163 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "com_ptr.h"
+
+// Multi-interface pointer
+//
+// Holds a reference to an object through its primary interface and the pointers to the object's other interfaces, each
+// queried on first use. A query is made at most once for each interface, whether or not the object implements it. The
+// references returned by QueryInterface are kept until the pointer is reset or destroyed, so that the cached pointers remain
+// valid even for tear-off interfaces.
+
+namespace belt::com
+{
+	namespace details
+	{
+		template<class Primary, class...Others>
+		class multi_ptr
+		{
+			static_assert(sizeof...(Others) < 32, "Too many interfaces");
+
+			com_ptr<Primary> primary;
+			mutable std::tuple<com_ptr<Others>...> others;
+			// Bit i is set once Others[i] has been queried
+			mutable uint32_t resolved{};
+
+			template<class Interface>
+			static constexpr size_t index_of() noexcept
+			{
+				constexpr bool same[]{ std::is_same_v<Interface, Others>... };
+				size_t index = 0;
+				while (!same[index])
+					++index;
+				return index;
+			}
+
+		public:
+			template<class Interface>
+			static constexpr bool contains = std::is_same_v<Interface, Primary> || (std::is_same_v<Interface, Others> || ...);
+
+			multi_ptr() noexcept = default;
+			multi_ptr(std::nullptr_t) noexcept {}
+
+			multi_ptr(com_ptr<Primary> p) noexcept :
+				primary{ std::move(p) }
+			{}
+
+			// Other interfaces of an object that are known without QueryInterface. The pointers must belong to the object
+			// referenced by p
+			multi_ptr(com_ptr<Primary> p, Others *...pointers) noexcept requires (sizeof...(Others) != 0) :
+				primary{ std::move(p) },
+				others{ com_ptr<Others>{ pointers }... },
+				resolved{ (uint32_t{ 1 } << sizeof...(Others)) - 1 }
+			{}
+
+			multi_ptr(const multi_ptr &) = default;
+
+			multi_ptr(multi_ptr &&o) noexcept :
+				primary{ std::move(o.primary) },
+				others{ std::move(o.others) },
+				resolved{ std::exchange(o.resolved, 0) }
+			{}
+
+			multi_ptr &operator =(multi_ptr o) noexcept
+			{
+				swap(o);
+				return *this;
+			}
+
+			void swap(multi_ptr &o) noexcept
+			{
+				std::swap(primary, o.primary);
+				std::swap(others, o.others);
+				std::swap(resolved, o.resolved);
+			}
+
+			void reset() noexcept
+			{
+				multi_ptr{}.swap(*this);
+			}
+
+			explicit operator bool() const noexcept
+			{
+				return !!primary;
+			}
+
+			Primary *operator ->() const noexcept
+			{
+				return primary.get();
+			}
+
+			// Returns a pointer to one of the listed interfaces, or nullptr if the object does not implement it. The pointer is
+			// valid as long as the multi_ptr is not reset, assigned or destroyed. Resolving an interface modifies the multi_ptr,
+			// so the same multi_ptr must not be used by several threads at once
+			template<class Interface = Primary>
+			Interface *get() const noexcept
+			{
+				static_assert(contains<Interface>, "Interface is not listed in multi_ptr");
+				if constexpr (std::is_same_v<Interface, Primary>)
+					return primary.get();
+				else
+				{
+					constexpr auto index = index_of<Interface>();
+					auto &cached = std::get<index>(others);
+					if (!(resolved & (uint32_t{ 1 } << index))) [[unlikely]]
+					{
+						cached = primary.template as<Interface>();
+						resolved |= uint32_t{ 1 } << index;
+					}
+					return cached.get();
+				}
+			}
+
+			const com_ptr<Primary> &ptr() const noexcept
+			{
+				return primary;
+			}
+
+			// Adds a reference through a cached pointer, or queries the object for an interface that is not listed
+			template<class Interface>
+			com_ptr<Interface> as() const noexcept
+			{
+				if constexpr (contains<Interface>)
+					return { get<Interface>() };
+				else
+					return primary.template as<Interface>();
+			}
+
+			template<class Interface>
+			requires contains<Interface>
+			operator ref<Interface>() const noexcept
+			{
+				return { get<Interface>() };
+			}
+
+			bool operator ==(const multi_ptr &o) const noexcept
+			{
+				return primary == o.primary;
+			}
+		};
+	}
+
+	using details::multi_ptr;
+}
+
+namespace bcom
+{
+	template<class Primary, class...Others>
+	using multi_ptr = belt::com::multi_ptr<Primary, Others...>;
+}
@@ -0,0 +1,254 @@
+//-------------------------------------------------------------------------------------------------------
+// moderncom - Part of HHD Software Belt library
+// Copyright (C) 2017 HHD Software Ltd.
+// Written by Alexander Bessonov
+//
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//-------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include "com_ptr.h"
+
+// Weak references
+//
+// An object that supports weak references keeps its reference count in a separately allocated control block. The control
+// block also counts weak references and outlives the object until the last weak reference is released. A weak reference
+// is resolved by adding a strong reference only if the object's reference count has not yet dropped to zero.
+
+namespace belt::com
+{
+	namespace details
+	{
+		// QueryInterface of an object that supports weak references returns its control block with an added weak reference
+		// for this identifier
+		inline constexpr GUID weak_control_block_id = make_guid("{9F3B5C2A-6E1D-4B8F-A7C4-2D5E8F1A3B60}");
+
+		class weak_control_block
+		{
+			std::atomic<int> strong{};
+			// Weak references plus one held by the object
+			std::atomic<int> weak{ 1 };
+			// Set when the reference count drops to zero. final_release may then temporarily set the count back to one
+			std::atomic<bool> expired{};
+			// Set for objects that observe AddRef calls with on_add_ref
+			std::atomic<bool> observed{};
+
+		public:
+			int fetch_add() noexcept
+			{
+				return strong.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			int fetch_sub() noexcept
+			{
+				auto prev = strong.fetch_sub(1, std::memory_order_acq_rel);
+				if (prev == 1)
+					expired.store(true, std::memory_order_relaxed);
+				return prev;
+			}
+
+			void store(int value) noexcept
+			{
+				// Makes expired visible to try_add that sees the stored value
+				strong.store(value, std::memory_order_release);
+			}
+
+			void add(int count) noexcept
+			{
+				strong.fetch_add(count, std::memory_order_relaxed);
+			}
+
+			// Adds a strong reference unless the object is destroyed or being destroyed
+			bool try_add() noexcept
+			{
+				auto count = strong.load(std::memory_order_relaxed);
+				do
+				{
+					if (count == 0)
+						return false;
+				} while (!strong.compare_exchange_weak(count, count + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+				if (expired.load(std::memory_order_relaxed))
+				{
+					strong.fetch_sub(1, std::memory_order_relaxed);
+					return false;
+				}
+				return true;
+			}
+
+			// Removes a reference added by try_add that has not been handed out
+			void undo_add() noexcept
+			{
+				strong.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			bool is_expired() const noexcept
+			{
+				return strong.load(std::memory_order_relaxed) == 0 || expired.load(std::memory_order_relaxed);
+			}
+
+			void set_observed() noexcept
+			{
+				observed.store(true, std::memory_order_relaxed);
+			}
+
+			bool is_observed() const noexcept
+			{
+				return observed.load(std::memory_order_relaxed);
+			}
+
+			void add_weak() noexcept
+			{
+				weak.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void release_weak() noexcept
+			{
+				if (weak.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					delete this;
+			}
+		};
+
+		// Reference count policy of objects that support weak references
+		struct weak_ref_count_base
+		{
+			weak_control_block *_rc_block{ new weak_control_block };
+
+			weak_ref_count_base() = default;
+			weak_ref_count_base(const weak_ref_count_base &) = delete;
+			weak_ref_count_base &operator =(const weak_ref_count_base &) = delete;
+
+			~weak_ref_count_base()
+			{
+				_rc_block->release_weak();
+			}
+
+			int _rc_fetch_add() noexcept
+			{
+				return _rc_block->fetch_add();
+			}
+
+			int _rc_fetch_sub(IUnknown *) noexcept
+			{
+				return _rc_block->fetch_sub();
+			}
+
+			void _rc_store(int value) noexcept
+			{
+				_rc_block->store(value);
+			}
+
+			bool _rc_try_add() noexcept
+			{
+				return _rc_block->try_add();
+			}
+
+			void safe_increment() noexcept
+			{
+				_rc_block->add(10);
+			}
+
+			void safe_decrement() noexcept
+			{
+				_rc_block->add(-10);
+			}
+		};
+
+		template<class Interface>
+		class weak_ref
+		{
+			Interface *p{};
+			weak_control_block *block{};
+
+		public:
+			weak_ref() noexcept = default;
+			weak_ref(std::nullptr_t) noexcept {}
+
+			// The weak reference is empty if the object does not support weak references
+			weak_ref(const com_ptr<Interface> &strong) noexcept
+			{
+				void *result;
+				if (strong && SUCCEEDED(strong->QueryInterface(weak_control_block_id, &result)))
+				{
+					p = strong.get();
+					block = static_cast<weak_control_block *>(result);
+				}
+			}
+
+			weak_ref(const weak_ref &o) noexcept :
+				p{ o.p },
+				block{ o.block }
+			{
+				if (block)
+					block->add_weak();
+			}
+
+			weak_ref(weak_ref &&o) noexcept :
+				p{ std::exchange(o.p, nullptr) },
+				block{ std::exchange(o.block, nullptr) }
+			{}
+
+			~weak_ref() noexcept
+			{
+				if (block)
+					block->release_weak();
+			}
+
+			weak_ref &operator =(weak_ref o) noexcept
+			{
+				std::swap(p, o.p);
+				std::swap(block, o.block);
+				return *this;
+			}
+
+			void reset() noexcept
+			{
+				weak_ref{}.swap(*this);
+			}
+
+			void swap(weak_ref &o) noexcept
+			{
+				std::swap(p, o.p);
+				std::swap(block, o.block);
+			}
+
+			// Returns a strong reference to the object, or an empty pointer if the object's reference count has dropped to zero
+			com_ptr<Interface> resolve() const noexcept
+			{
+				if (!block || !block->try_add())
+					return {};
+#if !BELT_HAS_REF_COOKIES
+				if (!block->is_observed())
+					return { attach, p };
+#endif
+				// Add a reference through the object, so that it is paired with a leak detection cookie and seen by on_add_ref
+				com_ptr<Interface> result{ p };
+				block->undo_add();
+				return result;
+			}
+
+			// The object may expire right after this function returns false
+			bool expired() const noexcept
+			{
+				return !block || block->is_expired();
+			}
+
+			explicit operator bool() const noexcept
+			{
+				return block != nullptr;
+			}
+		};
+	}
+
+	using details::weak_ref;
+}
+
+namespace bcom
+{
+	template<class T>
+	using weak_ref = belt::com::weak_ref<T>;
+}
@@ -1,9 +1,36 @@
+#if defined(_WIN32)
 #include <windows.h>
+#endif
 
+// Leak detection test programs are built with MODERNCOM_TEST_LEAK_DETECTION and keep leak detection or sampling enabled
+#if !defined(MODERNCOM_TEST_LEAK_DETECTION)
 #define BELT_COM_NO_LEAK_DETECTION
+#endif
 #include <moderncom/interfaces.h>
+#include <moderncom/guid_map.h>
+#include <moderncom/weak_ref.h>
+#include <moderncom/atomic_com_ptr.h>
+#include <moderncom/library.h>
+#include <moderncom/multi_ptr.h>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory_resource>
+#include <mutex>
+#include <random>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Declare sample interface
 
@@ -15,7 +42,7 @@ BELT_DEFINE_INTERFACE(ISampleInterface, "{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}"
 
 // Define implementation
 
-class __declspec(novtable) sample_object :
+class BELT_NOVTABLE sample_object :
 	public belt::com::object<sample_object, ISampleInterface>
 {
 	int default_answer;
@@ -37,6 +64,1699 @@ public:
 	{}
 };
 
+// Object that supports weak references and inspects them while it is being released
+
+class BELT_NOVTABLE weak_sample_object :
+	public belt::com::object<weak_sample_object, ISampleInterface>,
+	public belt::com::supports_weak_references
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+
+public:
+	// Weak reference to this object checked by final_release and the destructor
+	static inline bcom::weak_ref<ISampleInterface> *observer{};
+	static inline bool resolved_in_final_release{};
+	static inline bool resolved_in_destructor{};
+	static inline bool destroyed{};
+
+	~weak_sample_object()
+	{
+		resolved_in_destructor = observer && (observer->resolve() || !observer->expired());
+		destroyed = true;
+	}
+
+	static void final_release(std::unique_ptr<weak_sample_object>) noexcept
+	{
+		// The reference count is set back to one while final_release runs
+		resolved_in_final_release = observer && (observer->resolve() || !observer->expired());
+	}
+};
+
+// Object with deferred destruction that records the order in which objects are destroyed
+
+class BELT_NOVTABLE deferred_sample_object :
+	public belt::com::object<deferred_sample_object, ISampleInterface>,
+	public belt::com::deferred_destruction
+{
+	int id;
+	bcom::ptr<ISampleInterface> child;
+
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return id;
+	}
+
+public:
+	static inline std::vector<int> destroyed;
+	// Result of drain_deferred called from the destructor of an object that has a child
+	static inline size_t nested_drain{ static_cast<size_t>(-1) };
+
+	deferred_sample_object(int id, bcom::ptr<ISampleInterface> child = {}) noexcept :
+		id{ id },
+		child{ std::move(child) }
+	{}
+
+	~deferred_sample_object()
+	{
+		destroyed.push_back(id);
+		if (child)
+			nested_drain = belt::com::drain_deferred();
+		// child is released after the destructor body, while the queue is being drained
+	}
+};
+
+// Object with biased reference count that counts its destructions
+
+class BELT_NOVTABLE biased_sample_object :
+	public belt::com::object<biased_sample_object, ISampleInterface>,
+	public belt::com::biased_ref_count
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+
+public:
+	static inline std::atomic<int> destroyed{};
+
+	~biased_sample_object()
+	{
+		++destroyed;
+	}
+
+	void share() noexcept
+	{
+		hand_off();
+	}
+};
+
+// Object tracked by the cycle collector that holds a reference to another one
+
+BELT_DEFINE_INTERFACE(ILinkInterface, "{0C4F7B2E-9A61-4D3B-8E57-2B1F6A9C3D84}")
+{
+	virtual void link(bcom::ptr<ILinkInterface> next) noexcept = 0;
+	virtual bcom::ptr<ILinkInterface> unlink() noexcept = 0;
+};
+
+class BELT_NOVTABLE link_object :
+	public belt::com::object<link_object, ILinkInterface>,
+	public belt::com::collects_cycles
+{
+	std::mutex lock;
+	bcom::ptr<ILinkInterface> next;
+
+	virtual void link(bcom::ptr<ILinkInterface> p) noexcept override
+	{
+		std::scoped_lock l{ lock };
+		next = std::move(p);
+		members_changed();
+	}
+
+	virtual bcom::ptr<ILinkInterface> unlink() noexcept override
+	{
+		std::scoped_lock l{ lock };
+		members_changed();
+		return std::move(next);
+	}
+
+public:
+	static inline std::atomic<int> destroyed{};
+	// Called by traverse before it reports the member
+	static inline std::function<void(link_object *)> on_traverse;
+
+	~link_object()
+	{
+		++destroyed;
+	}
+
+	void traverse(belt::com::cycle_visitor &visitor)
+	{
+		if (on_traverse)
+			on_traverse(this);
+		std::scoped_lock l{ lock };
+		visitor(next);
+	}
+};
+
+// Object with interfaces from a deep hierarchy, some of them listed again, and dynamic entries that answer through an inner object
+
+BELT_DEFINE_INTERFACE_BASE(ILeftSample, ISampleInterface, "{6B1D2E3F-4A5C-4E7D-8F90-1A2B3C4D5E61}")
+{
+};
+
+BELT_DEFINE_INTERFACE(IRightSample, "{6B1D2E3F-4A5C-4E7D-8F90-1A2B3C4D5E62}")
+{
+};
+
+BELT_DEFINE_INTERFACE_BASE(IDeepSample, ILeftSample, "{6B1D2E3F-4A5C-4E7D-8F90-1A2B3C4D5E63}")
+{
+};
+
+BELT_DEFINE_INTERFACE(IInnerSample, "{6B1D2E3F-4A5C-4E7D-8F90-1A2B3C4D5E64}")
+{
+};
+
+BELT_DEFINE_INTERFACE(IOtherInnerSample, "{6B1D2E3F-4A5C-4E7D-8F90-1A2B3C4D5E65}")
+{
+};
+
+class BELT_NOVTABLE inner_object :
+	public belt::com::object<inner_object, IInnerSample, IOtherInnerSample>
+{
+public:
+	static inline int destroyed{};
+
+	~inner_object()
+	{
+		++destroyed;
+	}
+};
+
+class BELT_NOVTABLE query_object :
+	public belt::com::object<
+		query_object,
+		IDeepSample,
+		belt::com::eats_all<query_object>,
+		IRightSample,
+		belt::com::also<ILeftSample, ISampleInterface>,
+		belt::com::aggregates<query_object, IInnerSample>
+	>
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+
+public:
+	static inline int destroyed{};
+	static inline int eaten{};
+
+	bcom::ptr<IInnerSample> inner{ inner_object::create_instance().to_ptr() };
+
+	~query_object()
+	{
+		++destroyed;
+	}
+
+	void *on_query(belt::com::interface_wrapper<IInnerSample>) noexcept
+	{
+		return bcom::ptr<IInnerSample>{ inner }.detach();
+	}
+
+	void *on_eat_all(const IID &iid) noexcept
+	{
+		++eaten;
+		if (iid == belt::com::get_interface_guid<IOtherInnerSample>())
+			return inner.as<IOtherInnerSample>().detach();
+		return nullptr;
+	}
+};
+
+// Object with the given traits that counts its destructions
+
+template<class...Traits>
+class BELT_NOVTABLE counted_object :
+	public belt::com::object<counted_object<Traits...>, ISampleInterface>,
+	public Traits...
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+
+public:
+	static inline int destroyed{};
+
+	~counted_object()
+	{
+		++destroyed;
+	}
+};
+
+// Object whose references are recorded by leak detection
+
+class BELT_NOVTABLE leaky_object :
+	public belt::com::object<leaky_object, ISampleInterface>,
+	public belt::com::enable_leak_detection
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+};
+
+// Object allocated from the object pool, in a size class no other test uses
+
+class BELT_NOVTABLE pooled_object :
+	public belt::com::object<pooled_object, ISampleInterface>,
+	public belt::com::pooled
+{
+	char payload[600]{};
+
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+};
+
+// Object whose construction may fail, placed in a memory resource that counts its allocations
+
+class BELT_NOVTABLE arena_object :
+	public belt::com::object<arena_object, ISampleInterface>
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 42;
+	}
+
+public:
+	static inline int destroyed{};
+
+	explicit arena_object(bool fail)
+	{
+		if (fail)
+			throw std::runtime_error{ "construction failed" };
+	}
+
+	~arena_object()
+	{
+		++destroyed;
+	}
+};
+
+class counting_resource : public std::pmr::memory_resource
+{
+	virtual void *do_allocate(size_t bytes, size_t alignment) override
+	{
+		++allocations;
+		auto result = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		last = result;
+		last_size = bytes;
+		return result;
+	}
+
+	virtual void do_deallocate(void *p, size_t bytes, size_t alignment) override
+	{
+		++deallocations;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	virtual bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+public:
+	int allocations{};
+	int deallocations{};
+	const void *last{};
+	size_t last_size{};
+};
+
+// Classes available for default construction
+
+BELT_DEFINE_CLASS(registered_object_id, "{4F2A9C61-3B7E-4D85-A1C0-6E9B2D7F4A31}");
+BELT_DEFINE_CLASS(cached_object_id, "{4F2A9C61-3B7E-4D85-A1C0-6E9B2D7F4A32}");
+BELT_DEFINE_CLASS(unregistered_object_id, "{4F2A9C61-3B7E-4D85-A1C0-6E9B2D7F4A33}");
+
+class BELT_NOVTABLE registered_object :
+	public belt::com::object<registered_object, ISampleInterface>
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 1;
+	}
+};
+
+BELT_OBJ_ENTRY_AUTO2(registered_object_id, registered_object);
+
+class BELT_NOVTABLE cached_object :
+	public belt::com::object<cached_object, ISampleInterface>,
+	public belt::com::single_cached_instance
+{
+	virtual int sum(int a, int b) const noexcept override
+	{
+		return a + b;
+	}
+
+	virtual int get_answer() const noexcept override
+	{
+		return 2;
+	}
+
+public:
+	static inline std::atomic<int> created{};
+	static inline std::atomic<int> destroyed{};
+
+	cached_object() noexcept
+	{
+		++created;
+	}
+
+	~cached_object()
+	{
+		++destroyed;
+	}
+};
+
+BELT_OBJ_ENTRY_AUTO2(cached_object_id, cached_object);
+
+// Checks
+
+namespace
+{
+	int failures{};
+
+	void check(bool condition, const char *expression, int line)
+	{
+		if (!condition)
+		{
+			std::cerr << "main.cpp(" << line << "): check failed: " << expression << '\n';
+			++failures;
+		}
+	}
+
+#define CHECK(...) check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __LINE__)
+
+	GUID random_guid(std::mt19937_64 &random)
+	{
+		const uint64_t words[2]{ random(), random() };
+		return std::bit_cast<GUID>(words);
+	}
+
+	// Short form with uppercase digits, independent of to_chars
+	std::string guid_text(const GUID &guid)
+	{
+		std::string result(belt::com::details::short_guid_form_length, ' ');
+		belt::com::details::format_guid_scalar(guid, result.data());
+		return result;
+	}
+
+	// Both implementations of parse_guid must agree on every 36-character string
+	void check_parse_kernels(const std::string &text)
+	{
+#if BELT_HAS_SSE2
+		CHECK(belt::com::details::parse_guid_sse2(text.data()) == belt::com::details::parse_guid_scalar(text.data()));
+#else
+		static_cast<void>(text);
+#endif
+	}
+
+	void test_guid_parsing()
+	{
+		constexpr auto expected = belt::com::make_guid("{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}");
+		CHECK(belt::com::parse_guid("{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}") == expected);
+		CHECK(belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE-8252A8432B45") == expected);
+		CHECK(belt::com::parse_guid("ab9a7af1-6792-4d0a-83be-8252a8432b45") == expected);
+		static_assert(belt::com::parse_guid("{ab9a7af1-6792-4D0A-83be-8252A8432B45}") == expected);
+
+		// Wrong lengths and braces
+		CHECK(!belt::com::parse_guid(""));
+		CHECK(!belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE-8252A8432B4"));
+		CHECK(!belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE-8252A8432B455"));
+		CHECK(!belt::com::parse_guid("{AB9A7AF1-6792-4D0A-83BE-8252A8432B45"));
+		CHECK(!belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE-8252A8432B45}"));
+		CHECK(!belt::com::parse_guid("(AB9A7AF1-6792-4D0A-83BE-8252A8432B45)"));
+		CHECK(!belt::com::parse_guid("{AB9A7AF1-6792-4D0A-83BE-8252A8432B45]"));
+		CHECK(!belt::com::parse_guid("{{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}}"));
+		CHECK(!belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE-8252A8432B45  "));
+
+		// Misplaced dashes
+		CHECK(!belt::com::parse_guid("AB9A7AF16-792-4D0A-83BE-8252A8432B45"));
+		CHECK(!belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE8-252A8432B45"));
+		CHECK(!belt::com::parse_guid("AB9A7AF1-6792-4D0A-83BE-8252A8432B-5"));
+
+		// Every character of random GUIDs in both cases, replaced with characters around the ranges of valid digits and with
+		// bytes that are negative as signed char
+		std::mt19937_64 random{ 2017 };
+		constexpr std::string_view replacements{ "/0:9@AFG`afgz-{} \x7f\x80\xb0\xc1\xe6\xff" };
+		for (int i = 0; i < 200; ++i)
+		{
+			const auto guid = random_guid(random);
+			auto text = guid_text(guid);
+			CHECK(belt::com::parse_guid(text) == guid);
+			CHECK(belt::com::parse_guid("{" + text + "}") == guid);
+			check_parse_kernels(text);
+
+			for (auto &c : text)
+				c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			CHECK(belt::com::parse_guid(text) == guid);
+			check_parse_kernels(text);
+
+			for (size_t position = 0; position < text.size(); ++position)
+			{
+				auto mutated = text;
+				for (auto c : replacements)
+				{
+					mutated[position] = c;
+					const auto result = belt::com::parse_guid(mutated);
+					const bool dash = position == 8 || position == 13 || position == 18 || position == 23;
+					const bool valid = dash ? c == '-' : std::isxdigit(static_cast<unsigned char>(c)) != 0;
+					CHECK(result.has_value() == valid);
+					check_parse_kernels(mutated);
+				}
+			}
+		}
+
+		// Invalid strings produce null GUIDs
+		const std::string_view strings[]{
+			"{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}",
+			"not a GUID",
+			"AB9A7AF1-6792-4D0A-83BE-8252A8432B4G",
+			"00000000-0000-0000-0000-000000000001",
+		};
+		GUID parsed[std::size(strings)];
+		std::fill(std::begin(parsed), std::end(parsed), expected);
+		CHECK(belt::com::parse_guids(strings, parsed) == 2);
+		CHECK(parsed[0] == expected);
+		CHECK(parsed[1] == GUID{});
+		CHECK(parsed[2] == GUID{});
+		CHECK(parsed[3] == belt::com::make_guid("{00000000-0000-0000-0000-000000000001}"));
+		CHECK(belt::com::parse_guids({}, {}) == 0);
+	}
+
+	std::string to_string(const GUID &guid, bool braces = true)
+	{
+		char buffer[belt::com::details::long_guid_form_length];
+		return { buffer, belt::com::to_chars(buffer, guid, braces) };
+	}
+
+	constexpr bool formats_at_compile_time()
+	{
+		char buffer[belt::com::details::long_guid_form_length]{};
+		belt::com::to_chars(buffer, belt::com::make_guid("{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}"));
+		return std::string_view{ buffer, std::size(buffer) } == "{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}";
+	}
+
+	void test_guid_formatting()
+	{
+		static_assert(formats_at_compile_time());
+
+		constexpr auto guid = belt::com::make_guid("{ab9a7af1-6792-4d0a-83be-8252a8432b45}");
+		CHECK(to_string(guid) == "{AB9A7AF1-6792-4D0A-83BE-8252A8432B45}");
+		CHECK(to_string(guid, false) == "AB9A7AF1-6792-4D0A-83BE-8252A8432B45");
+		CHECK(to_string(GUID{}) == "{00000000-0000-0000-0000-000000000000}");
+		CHECK(to_string(belt::com::make_guid("{FFFFFFFF-FFFF-FFFF-FFFF-FFFFFFFFFFFF}"), false) == "FFFFFFFF-FFFF-FFFF-FFFF-FFFFFFFFFFFF");
+
+		std::ostringstream stream;
+		stream << guid << ' ' << GUID{};
+		CHECK(stream.str() == "{AB9A7AF1-6792-4D0A-83BE-8252A8432B45} {00000000-0000-0000-0000-000000000000}");
+
+		// to_chars must not write past the returned pointer
+		char buffer[40];
+		std::fill(std::begin(buffer), std::end(buffer), '*');
+		CHECK(belt::com::to_chars(buffer + 1, guid, false) == buffer + 37);
+		CHECK(buffer[0] == '*' && buffer[37] == '*');
+
+		std::mt19937_64 random{ 2017 };
+		for (int i = 0; i < 1000; ++i)
+		{
+			const auto value = random_guid(random);
+			const auto text = to_string(value);
+			CHECK(text == "{" + guid_text(value) + "}");
+			CHECK(belt::com::parse_guid(text) == value);
+			CHECK(belt::com::parse_guid(to_string(value, false)) == value);
+		}
+	}
+
+	template<class V>
+	bool same_contents(const bcom::guid_map<V> &map, const std::map<GUID, V> &expected)
+	{
+		if (map.size() != expected.size())
+			return false;
+		size_t visited{};
+		for (const auto &[key, value] : map)
+		{
+			auto it = expected.find(key);
+			if (it == expected.end() || it->second != value)
+				return false;
+			++visited;
+		}
+		return visited == expected.size();
+	}
+
+	void test_guid_map()
+	{
+		std::mt19937_64 random{ 2017 };
+
+		// Inserts and erases across rehashes, checked against std::map
+		{
+			bcom::guid_map<int> map;
+			std::map<GUID, int> expected;
+			std::vector<GUID> keys;
+			for (int i = 0; i < 5000; ++i)
+			{
+				keys.push_back(random_guid(random));
+				CHECK(map.try_emplace(keys.back(), i).second);
+				expected.emplace(keys.back(), i);
+			}
+			CHECK(!map.try_emplace(keys.front(), -1).second);
+			CHECK(map.find(keys.front())->second == 0);
+			CHECK(same_contents(map, expected));
+
+			for (size_t i = 0; i < keys.size(); i += 3)
+			{
+				CHECK(map.erase(keys[i]) == 1);
+				CHECK(map.erase(keys[i]) == 0);
+				expected.erase(keys[i]);
+			}
+			CHECK(same_contents(map, expected));
+			for (size_t i = 0; i < keys.size(); ++i)
+				CHECK(map.contains(keys[i]) == (i % 3 != 0));
+
+			// Erased slots are reused, growth rehashes the map with erased slots
+			for (int i = 0; i < 5000; ++i)
+			{
+				const auto key = random_guid(random);
+				map[key] = i;
+				expected[key] = i;
+			}
+			CHECK(same_contents(map, expected));
+
+			auto copy = map;
+			CHECK(same_contents(copy, expected));
+			map.clear();
+			CHECK(map.empty() && map.begin() == map.end() && !map.contains(keys[1]));
+			CHECK(same_contents(copy, expected));
+		}
+
+		// Keys with the same home group fill it and continue in the next groups of their probe sequence
+		{
+			bcom::guid_map<int> map;
+			map.reserve(40);
+			const auto capacity = map.capacity();
+			const auto groups = capacity / 16;
+
+			std::vector<GUID> keys, absent;
+			while (keys.size() < 24 || absent.size() < 8)
+			{
+				const auto key = random_guid(random);
+				if (((belt::com::hash_guid(key) >> 7) & (groups - 1)) == 0)
+					(keys.size() < 24 ? keys : absent).push_back(key);
+			}
+			for (int i = 0; i < 24; ++i)
+				map.try_emplace(keys[i], i);
+			CHECK(map.capacity() == capacity);
+			CHECK(map.probe_length(keys[0]) == 1);
+			CHECK(map.probe_length(keys[23]) > 1);
+
+			// Erasing from the full home group leaves a deleted slot that lookups must probe past
+			CHECK(map.erase(keys[0]) == 1);
+			CHECK(map.get_stats().deleted == 1);
+			for (int i = 1; i < 24; ++i)
+				CHECK(map.find(keys[i]) != map.end() && map.find(keys[i])->second == i);
+			for (const auto &key : absent)
+				CHECK(!map.contains(key));
+
+			CHECK(map.erase(keys[20]) == 1);
+			for (int i = 1; i < 24; ++i)
+				CHECK(map.contains(keys[i]) == (i != 20));
+
+			// A new key takes the deleted slot of its home group
+			CHECK(map.try_emplace(absent[0], 100).second);
+			CHECK(map.probe_length(absent[0]) == 1);
+			CHECK(map.get_stats().deleted == 0);
+			CHECK(map.find(absent[0])->second == 100);
+			for (int i = 1; i < 24; ++i)
+				CHECK(map.contains(keys[i]) == (i != 20));
+		}
+
+		// insert, insert_or_assign and operator []
+		{
+			bcom::guid_map<std::string> map;
+			const auto a = random_guid(random);
+			const auto b = random_guid(random);
+			CHECK(map.insert({ a, "a" }).second);
+			CHECK(!map.insert({ a, "x" }).second);
+			CHECK(map.find(a)->second == "a");
+
+			auto [it, inserted] = map.insert_or_assign(a, std::string{ "b" });
+			CHECK(!inserted && it->first == a && it->second == "b");
+			std::tie(it, inserted) = map.insert_or_assign(b, "c");
+			CHECK(inserted && map.find(b)->second == "c");
+			CHECK(map[b] == "c");
+			CHECK(map[random_guid(random)].empty());
+			CHECK(map.size() == 3);
+		}
+
+		// Iteration visits every element once after erase through an iterator
+		{
+			bcom::guid_map<int> map;
+			std::map<GUID, int> expected;
+			for (int i = 0; i < 100; ++i)
+			{
+				const auto key = random_guid(random);
+				map.try_emplace(key, i);
+				if (i % 2)
+					expected.emplace(key, i);
+			}
+			std::vector<GUID> even;
+			for (const auto &[key, value] : map)
+			{
+				if (value % 2 == 0)
+					even.push_back(key);
+			}
+			for (const auto &key : even)
+				map.erase(map.find(key));
+			CHECK(same_contents(map, expected));
+			CHECK(static_cast<size_t>(std::distance(map.begin(), map.end())) == expected.size());
+		}
+	}
+
+	void test_weak_ref()
+	{
+		bcom::weak_ref<ISampleInterface> weak;
+		{
+			auto strong = weak_sample_object::create_instance().to_ptr();
+			weak = strong;
+			CHECK(weak && !weak.expired());
+			CHECK(weak.resolve() == strong);
+
+			auto copy = weak;
+			weak_sample_object::observer = &copy;
+			auto resolved = weak.resolve();
+			strong = nullptr;
+			CHECK(!weak.expired() && weak.resolve() == resolved);
+			CHECK(!weak_sample_object::destroyed);
+		}
+		weak_sample_object::observer = nullptr;
+
+		// The reference count has dropped to zero: final_release and the destructor cannot resolve the object
+		CHECK(weak_sample_object::destroyed);
+		CHECK(!weak_sample_object::resolved_in_final_release);
+		CHECK(!weak_sample_object::resolved_in_destructor);
+
+		// The control block outlives the object while weak references remain
+		CHECK(weak && weak.expired() && !weak.resolve());
+		auto copy = weak;
+		weak.reset();
+		CHECK(!weak && weak.expired());
+		CHECK(copy && copy.expired() && !copy.resolve());
+
+		// Objects without the trait produce empty weak references
+		bcom::weak_ref<ISampleInterface> unsupported{ sample_object::create_instance(1).to_ptr() };
+		CHECK(!unsupported && unsupported.expired() && !unsupported.resolve());
+	}
+
+	void test_deferred_destruction()
+	{
+		using object = deferred_sample_object;
+		const auto before = belt::com::get_deferred_stats();
+
+		// Objects are destroyed by drain in the order they were released
+		{
+			std::vector<bcom::ptr<ISampleInterface>> objects;
+			for (int i = 0; i < 5; ++i)
+				objects.push_back(object::create_instance(i).to_ptr());
+			for (auto i : { 3, 1, 4, 0, 2 })
+				objects[i] = nullptr;
+			CHECK(object::destroyed.empty());
+			CHECK(belt::com::get_deferred_stats().depth == 5);
+			CHECK(belt::com::drain_deferred() == 5);
+			CHECK((object::destroyed == std::vector{ 3, 1, 4, 0, 2 }));
+			CHECK(belt::com::get_deferred_stats().depth == 0);
+			CHECK(belt::com::get_deferred_stats().reclaimed == before.reclaimed + 5);
+			CHECK(belt::com::drain_deferred() == 0);
+		}
+
+		// The releasing thread destroys the object itself when the queue is full
+		object::destroyed.clear();
+		belt::com::set_deferred_capacity(2);
+		{
+			auto a = object::create_instance(10).to_ptr();
+			auto b = object::create_instance(11).to_ptr();
+			auto c = object::create_instance(12).to_ptr();
+			a = nullptr;
+			b = nullptr;
+			CHECK(object::destroyed.empty());
+			c = nullptr;
+			CHECK((object::destroyed == std::vector{ 12 }));
+			CHECK(belt::com::get_deferred_stats().destroyed_inline == before.destroyed_inline + 1);
+			CHECK(belt::com::drain_deferred() == 2);
+			CHECK((object::destroyed == std::vector{ 12, 10, 11 }));
+		}
+		belt::com::set_deferred_capacity(65536);
+
+		// drain called from a destructor run by drain does nothing, and an object released by a destructor is destroyed by
+		// the same drain call
+		object::destroyed.clear();
+		{
+			auto parent = object::create_instance(20, object::create_instance(21).to_ptr()).to_ptr();
+			parent = nullptr;
+			CHECK(belt::com::drain_deferred() == 2);
+			CHECK(object::nested_drain == 0);
+			CHECK((object::destroyed == std::vector{ 20, 21 }));
+			CHECK(belt::com::get_deferred_stats().depth == 0);
+		}
+	}
+
+	// Released by the destructor of a thread-local object that is destroyed after the thread's biased owner
+	thread_local bcom::ptr<ISampleInterface> late_release;
+
+	void test_biased_ref_count()
+	{
+		using object = biased_sample_object;
+		const auto destroyed = [] { return object::destroyed.load(); };
+		auto run = [](auto &&f) { std::thread{ std::forward<decltype(f)>(f) }.join(); };
+
+		// The owner thread releases the last reference
+		{
+			const auto before = destroyed();
+			auto p = object::create_instance().to_ptr();
+			auto copy = p;
+			p = nullptr;
+			CHECK(destroyed() == before);
+			copy = nullptr;
+			CHECK(destroyed() == before + 1);
+		}
+
+		// A reference taken by the owner thread and released by another thread is merged by merge_biased_ref_counts
+		{
+			const auto before = destroyed();
+			auto p = object::create_instance().to_ptr();
+			run([p = std::move(p)]() mutable { p = nullptr; });
+			CHECK(destroyed() == before);
+			belt::com::merge_biased_ref_counts();
+			CHECK(destroyed() == before + 1);
+		}
+
+		// ... or by the owner thread's next Release of any biased object
+		{
+			const auto before = destroyed();
+			auto p = object::create_instance().to_ptr();
+			run([p = std::move(p)]() mutable { p = nullptr; });
+			CHECK(destroyed() == before);
+			object::create_instance().to_ptr() = nullptr;
+			CHECK(destroyed() == before + 2);
+		}
+
+		// References added by another thread go to the shared counter, the last one destroys the object on that thread
+		{
+			const auto before = destroyed();
+			auto p = object::create_instance().to_ptr();
+			run([p]() mutable
+			{
+				auto copy = p;
+				copy = nullptr;
+			});
+			CHECK(destroyed() == before);
+			p = nullptr;
+			CHECK(destroyed() == before + 1);
+		}
+
+		// After hand_off, the last reference released by another thread destroys the object immediately
+		{
+			const auto before = destroyed();
+			auto holder = object::create_instance();
+			auto raw = holder.obj();
+			auto p = std::move(holder).to_ptr();
+			raw->share();
+			run([p = std::move(p)]() mutable { p = nullptr; });
+			CHECK(destroyed() == before + 1);
+		}
+
+		// The owner thread merges queued objects when it exits. Objects released after that are merged by the releasing thread
+		{
+			const auto before = destroyed();
+			bcom::ptr<ISampleInterface> queued, orphan;
+			std::mutex lock;
+			std::condition_variable wake;
+			bool released{};
+			std::thread owner{ [&]
+			{
+				queued = object::create_instance().to_ptr();
+				orphan = object::create_instance().to_ptr();
+				std::unique_lock l{ lock };
+				wake.notify_all();
+				wake.wait(l, [&] { return released; });
+			} };
+			{
+				std::unique_lock l{ lock };
+				wake.wait(l, [&] { return queued && orphan; });
+				queued = nullptr;
+				released = true;
+			}
+			wake.notify_all();
+			owner.join();
+			CHECK(destroyed() == before + 1);
+			orphan = nullptr;
+			CHECK(destroyed() == before + 2);
+		}
+
+		// Release from a thread-local destructor that runs after the owner has been destroyed uses the shared counter
+		{
+			const auto before = destroyed();
+			run([]
+			{
+				late_release = nullptr;
+				late_release = object::create_instance().to_ptr();
+				auto copy = late_release;
+			});
+			CHECK(destroyed() == before + 1);
+		}
+	}
+
+	void test_cycle_collector()
+	{
+		using object = link_object;
+
+		const auto make_cycle = []
+		{
+			auto a = object::create_instance().to_ptr();
+			auto b = object::create_instance().to_ptr();
+			a->link(b);
+			b->link(a);
+			return a;
+		};
+
+		// A cycle referenced only by its members is destroyed
+		{
+			const auto before = object::destroyed.load();
+			make_cycle();
+			const auto result = belt::com::collect_cycles();
+			CHECK(result.objects == 2);
+			CHECK(!result.graph_changed);
+			CHECK(object::destroyed == before + 2);
+			CHECK(belt::com::collect_cycles().scanned == 0);
+		}
+
+		// A cycle with an external reference is kept alive and collected after the reference is released
+		{
+			const auto before = object::destroyed.load();
+			auto a = make_cycle();
+			auto result = belt::com::collect_cycles();
+			CHECK(result.scanned == 2);
+			CHECK(result.objects == 0);
+			CHECK(object::destroyed == before);
+
+			a = nullptr;
+			result = belt::com::collect_cycles();
+			CHECK(result.objects == 2);
+			CHECK(object::destroyed == before + 2);
+		}
+
+		// A member moved away and back while the collection runs leaves both snapshots equal, the epochs still reveal it
+		{
+			const auto before = object::destroyed.load();
+			auto root = object::create_instance().to_ptr();
+			root->link(object::create_instance().to_ptr());
+			make_cycle();
+
+			int moves{};
+			object::on_traverse = [&](object *node)
+			{
+				if (node == static_cast<object *>(root.get()) && moves++ == 0)
+					root->link(root->unlink());
+			};
+			auto result = belt::com::collect_cycles();
+			object::on_traverse = nullptr;
+			CHECK(moves == 2);
+			CHECK(result.graph_changed);
+			CHECK(result.objects == 0);
+			CHECK(object::destroyed == before);
+
+			result = belt::com::collect_cycles();
+			CHECK(!result.graph_changed);
+			CHECK(result.objects == 2);
+			CHECK(object::destroyed == before + 2);
+
+			root = nullptr;
+			CHECK(object::destroyed == before + 4);
+		}
+	}
+
+	void test_query_interface()
+	{
+		using belt::com::get_interface_guid;
+
+		const auto destroyed = query_object::destroyed;
+		const auto inner_destroyed = inner_object::destroyed;
+		auto holder = query_object::create_instance();
+		auto *object = holder.obj();
+		auto p = std::move(holder).to_ptr();
+
+		const auto query = [](IUnknown *source, const GUID &iid)
+		{
+			void *result{ &result };
+			const auto hr = source->QueryInterface(iid, &result);
+			CHECK((hr == S_OK) == (result != nullptr));
+			CHECK(hr == S_OK || hr == E_NOINTERFACE);
+			// Every interface starts with IUnknown, the object is kept alive by p
+			if (result)
+				static_cast<IUnknown *>(result)->Release();
+			return result;
+		};
+
+		// Every interface of the flattened hierarchy is answered from the table, before the eats_all entry declared earlier
+		const auto eaten = query_object::eaten;
+		CHECK(query(p.get(), get_interface_guid<IDeepSample>()) == static_cast<IDeepSample *>(object));
+		CHECK(query(p.get(), get_interface_guid<ILeftSample>()) == static_cast<ILeftSample *>(object));
+		CHECK(query(p.get(), get_interface_guid<IRightSample>()) == static_cast<IRightSample *>(object));
+		CHECK(query_object::eaten == eaten);
+
+		// ILeftSample and ISampleInterface are listed twice: through IDeepSample and in the also entry
+		CHECK(query(p.get(), get_interface_guid<ISampleInterface>()) == static_cast<ISampleInterface *>(object));
+		CHECK(query_object::eaten == eaten);
+
+		// Every interface has its own IUnknown base, the identity is the same whichever interface is queried
+		IUnknown *right = static_cast<IRightSample *>(object);
+		CHECK(query(p.get(), get_interface_guid<IUnknown>()) == object->GetUnknown());
+		CHECK(query(right, get_interface_guid<IUnknown>()) == object->GetUnknown());
+		CHECK(query(right, get_interface_guid<IDeepSample>()) == static_cast<IDeepSample *>(object));
+
+		// Dynamic entries are consulted in declaration order after the table misses
+		CHECK(query(p.get(), get_interface_guid<IInnerSample>()) == object->inner.get());
+		CHECK(query_object::eaten == eaten + 1);
+		CHECK(query(p.get(), get_interface_guid<IOtherInnerSample>()) == object->inner.as<IOtherInnerSample>().get());
+		CHECK(query_object::eaten == eaten + 2);
+
+		// Misses, including the zero key of empty table slots
+		CHECK(query(p.get(), get_interface_guid<ILinkInterface>()) == nullptr);
+		CHECK(query(p.get(), GUID{}) == nullptr);
+		CHECK(query_object::eaten == eaten + 4);
+
+		// References added by all queries have been released
+		p = nullptr;
+		CHECK(query_object::destroyed == destroyed + 1);
+		CHECK(inner_object::destroyed == inner_destroyed + 1);
+	}
+
+	template<class Object>
+	void check_ref_count_policy()
+	{
+		const auto destroyed = Object::destroyed;
+		auto p = Object::create_instance().to_ptr();
+		CHECK(p->AddRef() == 2);
+		{
+			auto copy = p;
+			CHECK(p->AddRef() == 4);
+			CHECK(p->Release() == 3);
+		}
+		CHECK(p->Release() == 1);
+		CHECK(Object::destroyed == destroyed);
+		p = nullptr;
+		CHECK(Object::destroyed == destroyed + 1);
+	}
+
+	// A cached instance is reused while it is alive and is not revived after its count drops to zero, which relies on the
+	// policy's _rc_try_add
+	template<class Object>
+	void check_try_add_ref()
+	{
+		const auto create = []
+		{
+			bcom::ptr<ISampleInterface> result;
+			CHECK(SUCCEEDED(Object::factory_create_object(belt::com::get_interface_guid<ISampleInterface>(), reinterpret_cast<void **>(result.put()))));
+			return result;
+		};
+
+		const auto destroyed = Object::destroyed;
+		auto a = create();
+		auto b = create();
+		CHECK(a && a == b);
+		CHECK(a->AddRef() == 3);
+		CHECK(a->Release() == 2);
+		a = nullptr;
+		CHECK(Object::destroyed == destroyed);
+		b = nullptr;
+		CHECK(Object::destroyed == destroyed + 1);
+
+		auto c = create();
+		CHECK(c->AddRef() == 2);
+		CHECK(c->Release() == 1);
+		c = nullptr;
+		CHECK(Object::destroyed == destroyed + 2);
+	}
+
+	void test_ref_count_policies()
+	{
+		check_ref_count_policy<counted_object<>>();
+		check_ref_count_policy<counted_object<belt::com::wide_ref_count>>();
+		check_ref_count_policy<counted_object<belt::com::single_threaded_ref_count>>();
+
+		check_try_add_ref<counted_object<belt::com::single_cached_instance>>();
+		check_try_add_ref<counted_object<belt::com::single_cached_instance, belt::com::wide_ref_count>>();
+		check_try_add_ref<counted_object<belt::com::single_cached_instance, belt::com::single_threaded_ref_count>>();
+	}
+
+	// Reference count of an object, without changing it
+	ULONG ref_count(IUnknown *p) noexcept
+	{
+		p->AddRef();
+		return p->Release();
+	}
+
+	void test_atomic_com_ptr()
+	{
+		using object = counted_object<>;
+
+		CHECK(bcom::atomic_ptr<ISampleInterface>::is_always_lock_free == BELT_HAS_LOCK_FREE_ATOMIC_PTR);
+
+		const auto destroyed = object::destroyed;
+		auto a = object::create_instance().to_ptr();
+		auto b = object::create_instance().to_ptr();
+
+		{
+			bcom::atomic_ptr<ISampleInterface> value{ a };
+			CHECK(ref_count(a.get()) == 2);
+			CHECK(value.load() == a);
+			CHECK(ref_count(a.get()) == 2);
+
+			// Failed compare_exchange returns the current value in expected and keeps the desired one
+			auto expected = b;
+			CHECK(!value.compare_exchange(expected, b));
+			CHECK(expected == a);
+			CHECK(ref_count(a.get()) == 3);
+			CHECK(ref_count(b.get()) == 1);
+
+			CHECK(value.compare_exchange(expected, b));
+			CHECK(expected == a);
+			CHECK(value.load() == b);
+			expected = nullptr;
+			CHECK(ref_count(a.get()) == 1);
+			CHECK(ref_count(b.get()) == 2);
+
+			CHECK(value.exchange(nullptr) == b);
+			CHECK(!value.load());
+			CHECK(ref_count(b.get()) == 1);
+			value = a;
+		}
+		CHECK(ref_count(a.get()) == 1);
+		a = nullptr;
+		b = nullptr;
+		CHECK(object::destroyed == destroyed + 2);
+
+		// Readers load and use the pointer while writers replace it
+		{
+			std::vector<bcom::ptr<ISampleInterface>> objects;
+			for (unsigned i = 0; i != 4; ++i)
+				objects.push_back(object::create_instance().to_ptr());
+			bcom::atomic_ptr<ISampleInterface> value{ objects[0] };
+			std::atomic<bool> stop{};
+			std::atomic<int> unknown{};
+			std::vector<std::thread> threads;
+			for (unsigned i = 0; i != 4; ++i)
+			{
+				threads.emplace_back([&, i]
+				{
+					std::minstd_rand random{ i };
+					while (!stop.load(std::memory_order_relaxed))
+					{
+						if (i % 2 == 0)
+						{
+							auto p = value.load();
+							if (!p || p->get_answer() != 42 || std::find(objects.begin(), objects.end(), p) == objects.end())
+								++unknown;
+						}
+						else if (random() % 2 == 0)
+							value.exchange(objects[random() % objects.size()]);
+						else
+						{
+							auto expected = objects[random() % objects.size()];
+							value.compare_exchange(expected, objects[random() % objects.size()]);
+						}
+					}
+				});
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 200 });
+			stop = true;
+			for (auto &thread : threads)
+				thread.join();
+			CHECK(unknown == 0);
+
+			value = nullptr;
+			for (const auto &p : objects)
+				CHECK(ref_count(p.get()) == 1);
+		}
+		CHECK(object::destroyed == destroyed + 6);
+	}
+
+#if BELT_HAS_REF_COOKIES
+#if BELT_HAS_LEAK_DETECTION
+	// Adds a reference from a frame of its own and returns the address it returns to, which must be in the recorded stack
+	BELT_NOINLINE bcom::ptr<ISampleInterface> add_leak_reference(const bcom::ptr<ISampleInterface> &p, const void *&caller)
+	{
+#if defined(_MSC_VER)
+		caller = _ReturnAddress();
+#else
+		caller = __builtin_return_address(0);
+#endif
+		return p;
+	}
+#endif
+
+	// Outstanding references to leaky_object, all from the same stack
+	std::vector<belt::com::leak_report_entry> get_leaky_entries()
+	{
+		auto entries = belt::com::get_leak_report();
+		std::erase_if(entries, [](const auto &entry) { return entry.class_name.find("leaky_object") == std::string_view::npos; });
+		return entries;
+	}
+
+	bool starts_with_line(const std::string &text, const std::string &line)
+	{
+		return text.compare(0, line.size() + 1, line + '\n') == 0;
+	}
+
+	void test_leak_detection()
+	{
+		auto p = leaky_object::create_instance().to_ptr();
+
+#if BELT_HAS_LEAK_DETECTION
+		// References added by the same call site share one interned stack. The count is volatile so that the loop is not
+		// unrolled into two call sites
+		std::vector<bcom::ptr<ISampleInterface>> references;
+		const void *caller{};
+		volatile int count = 2;
+		for (int i = 0; i != count; ++i)
+			references.push_back(add_leak_reference(p, caller));
+
+		auto entries = get_leaky_entries();
+		CHECK(entries.size() == 2);
+		if (entries.size() == 2)
+		{
+			const auto &entry = entries[0];
+			CHECK(entry.count == 2);
+			CHECK(entry.first_ordinal < entry.last_ordinal);
+			CHECK(entries[1].count == 1);
+			CHECK(entries[1].stack != entry.stack);
+
+			CHECK(std::find(entry.stack->frames, entry.stack->frames + entry.stack->size, caller) != entry.stack->frames + entry.stack->size);
+			CHECK(entry.stack->size != 0 && !entry.stack->symbolize(0).empty());
+		}
+
+		std::ostringstream json;
+		belt::com::write_leak_report(json);
+		const auto report = json.str();
+		CHECK(starts_with_line(report, "{"));
+		CHECK(report.find("\n  \"sampling_rate\": 1,\n  \"references\": 3,\n  \"entries\": [\n") != std::string::npos);
+		CHECK(report.find("      \"count\": 2,\n") != std::string::npos);
+		CHECK(report.find("\"class\": \"") != std::string::npos);
+		CHECK(report.find("\"stack\": [\"0x") != std::string::npos);
+		CHECK(report.find("\"frames\": [\n        \"") != std::string::npos);
+		CHECK(report.ends_with("\n  ]\n}\n"));
+
+		std::ostringstream pprof;
+		belt::com::write_leak_report(pprof, belt::com::leak_report_format::pprof);
+		const auto profile = pprof.str();
+		CHECK(starts_with_line(profile, "heap profile: 3: 3 [3: 3] @ heapprofile"));
+		CHECK(profile.find("\n2: 2 [2: 2] @ 0x") != std::string::npos);
+		CHECK(profile.find("\n1: 1 [1: 1] @ 0x") != std::string::npos);
+#if defined(__linux__)
+		CHECK(profile.find("\nMAPPED_LIBRARIES:\n") != std::string::npos);
+#endif
+
+		// A reference released by another thread is paired with its record through the cookie channel
+		std::thread{ [reference = std::move(references.back())]() mutable { reference = nullptr; } }.join();
+		references.pop_back();
+		entries = get_leaky_entries();
+		CHECK(entries.size() == 2 && entries[0].count == 1 && entries[1].count == 1);
+
+		references.clear();
+		p = nullptr;
+		CHECK(get_leaky_entries().empty());
+
+		std::ostringstream empty;
+		belt::com::write_leak_report(empty);
+		CHECK(empty.str() == "{\n  \"sampling_rate\": 1,\n  \"references\": 0,\n  \"entries\": []\n}\n");
+#else
+		const auto count = [&]
+		{
+			size_t result{};
+			for (const auto &entry : get_leaky_entries())
+				result += entry.count;
+			return result;
+		};
+
+		// The first AddRef on a thread only starts the countdown, later ones are sampled one in rate on average
+		CHECK(belt::com::get_leak_sampling_rate() == BELT_COM_LEAK_SAMPLING_RATE);
+		belt::com::set_leak_sampling_rate(16);
+		std::vector<bcom::ptr<ISampleInterface>> references(32000, p);
+		const auto sampled = count();
+		CHECK(sampled > 1600 && sampled < 2400);
+
+		std::ostringstream json;
+		belt::com::write_leak_report(json);
+		CHECK(json.str().find("\n  \"sampling_rate\": 16,\n") != std::string::npos);
+
+		std::ostringstream pprof;
+		belt::com::write_leak_report(pprof, belt::com::leak_report_format::pprof);
+		size_t total{};
+		for (const auto &entry : belt::com::get_leak_report())
+			total += entry.count * 16;
+		CHECK(starts_with_line(pprof.str(), "heap profile: " + std::to_string(total) + ": " + std::to_string(total) + " [" + std::to_string(total) + ": " + std::to_string(total) + "] @ heapprofile"));
+
+		// Disabled sampling records nothing, released references remove their records
+		belt::com::set_leak_sampling_rate(0);
+		std::vector<bcom::ptr<ISampleInterface>> unsampled(32000, p);
+		CHECK(count() == sampled);
+		unsampled.clear();
+		CHECK(count() == sampled);
+		references.clear();
+		CHECK(count() == 0);
+		belt::com::set_leak_sampling_rate(BELT_COM_LEAK_SAMPLING_RATE);
+#endif
+	}
+#endif
+
+	belt::com::pool_stats get_pooled_object_stats()
+	{
+		for (const auto &stats : belt::com::get_pool_stats())
+			if (stats.block_size >= sizeof(pooled_object) && stats.block_size < sizeof(pooled_object) + 64)
+				return stats;
+		return {};
+	}
+
+	void test_pooled()
+	{
+		constexpr size_t count = 200;
+		CHECK(get_pooled_object_stats().reserved == 0);
+
+		// A freed block is reused by the next object of the thread
+		{
+			auto holder = pooled_object::create_instance();
+			const auto address = holder.obj();
+			std::move(holder).to_ptr() = nullptr;
+			CHECK(pooled_object::create_instance().obj() == address);
+		}
+
+		// The thread's cache has taken a batch of blocks
+		auto before = get_pooled_object_stats();
+		CHECK(before.block_size % 16 == 0);
+		CHECK(before.in_use == 32);
+
+		// Reserved blocks are taken without allocating from the system
+		belt::com::reserve_pool<pooled_object>(count);
+		before = get_pooled_object_stats();
+		CHECK(before.reserved >= count + 32);
+
+		// Objects created by one thread and released by another go back to the global list when the threads exit
+		std::vector<bcom::ptr<ISampleInterface>> objects;
+		std::thread{ [&]
+		{
+			for (size_t i = 0; i != count; ++i)
+				objects.push_back(pooled_object::create_instance().to_ptr());
+		} }.join();
+		auto stats = get_pooled_object_stats();
+		CHECK(stats.reserved == before.reserved);
+		CHECK(stats.in_use >= count);
+		CHECK(stats.high_water >= count);
+
+		std::thread{ [&] { objects.clear(); } }.join();
+		stats = get_pooled_object_stats();
+		CHECK(stats.reserved == before.reserved);
+		CHECK(stats.high_water >= count);
+
+		// The blocks taken by this thread's cache are all that is left in use
+		CHECK(stats.in_use == 32);
+		std::thread{ [&]
+		{
+			for (size_t i = 0; i != count; ++i)
+				objects.push_back(pooled_object::create_instance().to_ptr());
+			objects.clear();
+		} }.join();
+		CHECK(get_pooled_object_stats().in_use == 32);
+		CHECK(get_pooled_object_stats().reserved == before.reserved);
+	}
+
+	void test_create_instance_in()
+	{
+		const auto destroyed = arena_object::destroyed;
+		counting_resource resource;
+
+		// The object is placed in the resource. Its destructor runs on the last release, the memory is reclaimed with the
+		// resource
+		{
+			std::pmr::monotonic_buffer_resource arena{ &resource };
+			auto holder = arena_object::create_instance_in(arena, false);
+			const auto address = reinterpret_cast<const char *>(holder.obj());
+			auto p = std::move(holder).to_ptr();
+			CHECK(resource.allocations == 1);
+			CHECK(address >= resource.last && address < static_cast<const char *>(resource.last) + resource.last_size);
+			CHECK(p->sum(2, 3) == 5);
+
+			auto copy = p;
+			p = nullptr;
+			CHECK(arena_object::destroyed == destroyed);
+			copy = nullptr;
+			CHECK(arena_object::destroyed == destroyed + 1);
+			CHECK(resource.deallocations == 0);
+		}
+		CHECK(resource.deallocations == 1);
+
+		// Memory of an object whose constructor throws is returned to the resource
+		bool thrown{};
+		try
+		{
+			arena_object::create_instance_in(resource, true);
+		}
+		catch (const std::runtime_error &)
+		{
+			thrown = true;
+		}
+		CHECK(thrown);
+		CHECK(resource.allocations == 2);
+		CHECK(resource.deallocations == 2);
+		CHECK(arena_object::destroyed == destroyed + 1);
+	}
+
+	void test_class_registry()
+	{
+		const auto classes = belt::com::get_registered_classes();
+		CHECK(classes.size() == 2);
+		for (const auto &clsid : { registered_object_id, cached_object_id })
+			CHECK(std::count_if(classes.begin(), classes.end(), [&](const belt::com::registered_class &entry) { return entry.clsid == clsid; }) == 1);
+
+		const auto stats = belt::com::get_class_registry_stats();
+		CHECK(stats.classes == 2);
+		CHECK(stats.duplicates == 0);
+		CHECK(stats.capacity >= 2);
+		CHECK(stats.max_probes >= 1);
+
+		auto p = belt::com::create_object<ISampleInterface>(registered_object_id);
+		CHECK(p && p->get_answer() == 1);
+		p = belt::com::create_object<ISampleInterface>(cached_object_id);
+		CHECK(p && p->get_answer() == 2);
+
+		// The class is found, but does not implement the interface
+		bcom::ptr<ILinkInterface> link;
+		CHECK(belt::com::create_object(registered_object_id, link) == E_NOINTERFACE);
+		CHECK(!link);
+
+		// Unknown CLSIDs
+		bcom::ptr<ISampleInterface> missing;
+		CHECK(belt::com::create_object(unregistered_object_id, missing) == REGDB_E_CLASSNOTREG);
+		CHECK(belt::com::create_object(GUID{}, missing) == REGDB_E_CLASSNOTREG);
+		CHECK(!missing);
+		bool thrown{};
+		try
+		{
+			belt::com::create_object<ISampleInterface>(unregistered_object_id);
+		}
+		catch (const corsl::hresult_error &e)
+		{
+			thrown = e.code() == REGDB_E_CLASSNOTREG;
+		}
+		CHECK(thrown);
+	}
+
+	void test_class_factories()
+	{
+		const auto get_factory = [](const GUID &clsid, const GUID &iid = belt::com::get_interface_guid<IClassFactory>())
+		{
+			void *result{ &result };
+			const auto hr = belt::com::DllGetClassObject(clsid, iid, &result);
+			CHECK(SUCCEEDED(hr) == (result != nullptr));
+			return bcom::ptr<IClassFactory>{ belt::com::attach, static_cast<IClassFactory *>(result) };
+		};
+
+		// The factory is created on first request and returned for every later one
+		auto factory = get_factory(registered_object_id);
+		CHECK(factory);
+		CHECK(get_factory(registered_object_id) == factory);
+		CHECK(get_factory(registered_object_id, belt::com::get_interface_guid<IUnknown>()) == factory);
+		CHECK(get_factory(cached_object_id) != factory);
+
+		bcom::ptr<ISampleInterface> p;
+		CHECK(SUCCEEDED(factory->CreateInstance(nullptr, belt::com::get_interface_guid<ISampleInterface>(), reinterpret_cast<void **>(p.put()))));
+		CHECK(p && p->get_answer() == 1);
+
+		// Concurrent first requests all get the factory that has been published
+		std::vector<bcom::ptr<IClassFactory>> factories(4);
+		std::atomic<bool> start{};
+		std::vector<std::thread> threads;
+		for (auto &result : factories)
+			threads.emplace_back([&]
+			{
+				while (!start.load(std::memory_order_acquire))
+					std::this_thread::yield();
+				result = get_factory(cached_object_id);
+			});
+		start.store(true, std::memory_order_release);
+		for (auto &thread : threads)
+			thread.join();
+		for (const auto &result : factories)
+			CHECK(result && result == factories[0]);
+
+		CHECK(!get_factory(unregistered_object_id));
+		void *unknown{ &unknown };
+		CHECK(belt::com::DllGetClassObject(unregistered_object_id, belt::com::get_interface_guid<IClassFactory>(), &unknown) == CLASS_E_CLASSNOTAVAILABLE);
+		CHECK(!unknown);
+		CHECK(belt::com::DllGetClassObject(registered_object_id, belt::com::get_interface_guid<IClassFactory>(), nullptr) == E_POINTER);
+		CHECK(!get_factory(registered_object_id, belt::com::get_interface_guid<ISampleInterface>()));
+
+		CHECK(belt::com::DllCanUnloadNow() == S_OK);
+		CHECK(SUCCEEDED(factory->LockServer(true)));
+		CHECK(belt::com::DllCanUnloadNow() == S_FALSE);
+		CHECK(SUCCEEDED(factory->LockServer(false)));
+		CHECK(belt::com::DllCanUnloadNow() == S_OK);
+	}
+
+	void test_single_cached_instance()
+	{
+		const auto create = [] { return belt::com::create_object<ISampleInterface>(cached_object_id); };
+		const auto created = cached_object::created.load();
+		const auto destroyed = cached_object::destroyed.load();
+
+		// The instance is reused while it is alive, from any thread
+		auto a = create();
+		auto b = create();
+		CHECK(a == b);
+		std::thread{ [&] { CHECK(create() == a); } }.join();
+		CHECK(cached_object::created == created + 1);
+		a = nullptr;
+		CHECK(cached_object::destroyed == destroyed);
+
+		// After the last release, the next request creates a new instance
+		b = nullptr;
+		CHECK(cached_object::destroyed == destroyed + 1);
+		auto c = create();
+		CHECK(c && c->get_answer() == 2);
+		CHECK(cached_object::created == created + 2);
+		c = nullptr;
+		CHECK(cached_object::destroyed == destroyed + 2);
+
+		// Threads that create and release the instance concurrently always get a live one, and all are destroyed
+		std::vector<std::thread> threads;
+		std::atomic<int> invalid{};
+		for (int i = 0; i != 4; ++i)
+			threads.emplace_back([&]
+			{
+				for (int j = 0; j != 10000; ++j)
+				{
+					auto p = create();
+					// p keeps one instance alive, destroyed is read first so that instances created in between are counted
+					const auto dead = cached_object::destroyed.load();
+					if (!p || p->get_answer() != 2 || cached_object::created.load() <= dead)
+						++invalid;
+				}
+			});
+		for (auto &thread : threads)
+			thread.join();
+		CHECK(invalid == 0);
+		CHECK(cached_object::created == cached_object::destroyed);
+	}
+
+	uint64_t guid_time_ms(const GUID &guid)
+	{
+		return uint64_t{ guid.Data1 } << 16 | guid.Data2;
+	}
+
+	bool has_version(const GUID &guid, unsigned version)
+	{
+		return (guid.Data3 >> 12) == version && (guid.Data4[0] & 0xc0) == 0x80;
+	}
+
+	bool strictly_increasing(std::span<const GUID> guids)
+	{
+		return std::adjacent_find(guids.begin(), guids.end(), [](const GUID &a, const GUID &b) { return belt::com::compare_guids(a, b) >= 0; }) == guids.end();
+	}
+
+	// Version and variant bits of random and time-ordered GUIDs, and the ordering of time-ordered GUIDs under a controlled clock
+	void test_guid_generation()
+	{
+		std::vector<GUID> guids(1000);
+		for (auto &guid : guids)
+			guid = belt::com::generate_guid();
+		belt::com::generate_guids(std::span{ guids }.subspan(500));
+		CHECK(std::all_of(guids.begin(), guids.end(), [](const GUID &guid) { return has_version(guid, 4); }));
+		std::sort(guids.begin(), guids.end(), [](const GUID &a, const GUID &b) { return belt::com::compare_guids(a, b) < 0; });
+		CHECK(strictly_increasing(guids));
+
+		for (auto &guid : guids)
+			guid = belt::com::generate_guid_v7();
+		CHECK(strictly_increasing(guids));
+		belt::com::generate_guids_v7(guids);
+		CHECK(strictly_increasing(guids));
+		CHECK(std::all_of(guids.begin(), guids.end(), [](const GUID &guid) { return has_version(guid, 7); }));
+
+		belt::com::details::guid_generator generator;
+
+		// Within one millisecond, the timestamp is kept and the counter orders the GUIDs
+		for (auto &guid : guids)
+			guid = generator.v7(1000);
+		CHECK(strictly_increasing(guids));
+		CHECK(std::all_of(guids.begin(), guids.end(), [](const GUID &guid) { return has_version(guid, 7) && guid_time_ms(guid) == 1000; }));
+
+		// A clock going backwards does not break the order
+		auto previous = guids.back();
+		auto next = generator.v7(500);
+		CHECK(belt::com::compare_guids(previous, next) < 0);
+		CHECK(guid_time_ms(next) == 1000);
+
+		// Batches continue the sequence of the generator
+		generator.v7(guids, 999);
+		CHECK(belt::com::compare_guids(next, guids.front()) < 0);
+		CHECK(strictly_increasing(guids));
+		CHECK(std::all_of(guids.begin(), guids.end(), [](const GUID &guid) { return has_version(guid, 7) && guid_time_ms(guid) == 1000; }));
+
+		// An overflowing counter advances the timestamp by a millisecond, at most 2^26 GUIDs later
+		auto batches = (uint64_t{ 1 } << 26) / guids.size() + 1;
+		while (guid_time_ms(guids.back()) == 1000 && batches--)
+		{
+			previous = guids.back();
+			generator.v7(guids, 1000);
+			CHECK(belt::com::compare_guids(previous, guids.front()) < 0);
+		}
+		CHECK(strictly_increasing(guids));
+		CHECK(guid_time_ms(guids.back()) == 1001);
+		CHECK(std::all_of(guids.begin(), guids.end(), [](const GUID &guid) { return has_version(guid, 7); }));
+
+		// A later clock restarts from its own timestamp
+		next = generator.v7(2000);
+		CHECK(belt::com::compare_guids(guids.back(), next) < 0);
+		CHECK(guid_time_ms(next) == 2000);
+	}
+
+	void test_multi_ptr()
+	{
+		using pointer = bcom::multi_ptr<IDeepSample, IRightSample, IOtherInnerSample, ILinkInterface>;
+
+		const auto destroyed = query_object::destroyed;
+		auto holder = query_object::create_instance();
+		auto *object = holder.obj();
+		pointer p{ std::move(holder).to_ptr<IDeepSample>() };
+		IUnknown *identity = object->GetUnknown();
+		CHECK(p && p.get() == static_cast<IDeepSample *>(object));
+		CHECK(ref_count(identity) == 1);
+
+		// Each listed interface is queried once, on first use, including the one the object does not implement
+		const auto eaten = query_object::eaten;
+		CHECK(p.get<IRightSample>() == static_cast<IRightSample *>(object));
+		CHECK(ref_count(identity) == 2);
+		CHECK(p.get<IRightSample>() == static_cast<IRightSample *>(object));
+		CHECK(ref_count(identity) == 2);
+
+		const auto other = object->inner.as<IOtherInnerSample>();
+		CHECK(p.get<IOtherInnerSample>() == other.get());
+		CHECK(query_object::eaten == eaten + 1);
+		CHECK(p.get<IOtherInnerSample>() == other.get());
+		CHECK(query_object::eaten == eaten + 1);
+
+		CHECK(p.get<ILinkInterface>() == nullptr);
+		CHECK(query_object::eaten == eaten + 2);
+		CHECK(p.get<ILinkInterface>() == nullptr);
+		CHECK(!p.as<ILinkInterface>());
+		CHECK(query_object::eaten == eaten + 2);
+
+		// as adds a reference through the cache for listed interfaces and queries the object for others
+		{
+			const auto right = p.as<IRightSample>();
+			CHECK(right.get() == static_cast<IRightSample *>(object));
+			CHECK(ref_count(identity) == 3);
+			const auto left = p.as<ILeftSample>();
+			CHECK(left.get() == static_cast<ILeftSample *>(object));
+			CHECK(ref_count(identity) == 4);
+			CHECK(p.as<IInnerSample>().get() == object->inner.get());
+			CHECK(query_object::eaten == eaten + 3);
+		}
+		CHECK(ref_count(identity) == 2);
+
+		// A copy shares the object and holds its own references to the cached interfaces
+		auto copy = p;
+		CHECK(copy == p);
+		CHECK(ref_count(identity) == 4);
+		CHECK(copy.get<IRightSample>() == static_cast<IRightSample *>(object));
+		CHECK(copy.get<ILinkInterface>() == nullptr);
+		CHECK(query_object::eaten == eaten + 3);
+		copy.reset();
+		CHECK(!copy);
+		CHECK(ref_count(identity) == 2);
+
+		// A move transfers the references and the cache
+		auto moved = std::move(p);
+		CHECK(!p);
+		CHECK(ref_count(identity) == 2);
+		CHECK(moved.get<IRightSample>() == static_cast<IRightSample *>(object));
+		CHECK(moved.get<ILinkInterface>() == nullptr);
+		CHECK(query_object::eaten == eaten + 3);
+		moved.reset();
+		CHECK(!moved);
+		CHECK(query_object::destroyed == destroyed + 1);
+
+		// to_multi_ptr fills the cache with static casts, holding a reference for each listed interface
+		holder = query_object::create_instance();
+		object = holder.obj();
+		identity = object->GetUnknown();
+		auto filled = std::move(holder).to_multi_ptr<IDeepSample, IRightSample, ILeftSample>();
+		CHECK(ref_count(identity) == 3);
+		CHECK(filled.get() == static_cast<IDeepSample *>(object));
+		CHECK(filled.get<IRightSample>() == static_cast<IRightSample *>(object));
+		CHECK(filled.get<ILeftSample>() == static_cast<ILeftSample *>(object));
+		CHECK(ref_count(identity) == 3);
+		filled = nullptr;
+		CHECK(query_object::destroyed == destroyed + 2);
+	}
+}
+
 int main()
 {
 	// Create new instance of sample_object and get its' ISampleInterface interface pointer
@@ -44,6 +1764,29 @@ int main()
 	{
 		auto obj = sample_object::create_instance(42).to_ptr();
 
-		std::cout << obj->sum(obj->get_answer(), 5);
+		std::cout << obj->sum(obj->get_answer(), 5) << '\n';
 	}
+
+	test_guid_parsing();
+	test_guid_formatting();
+	test_guid_map();
+	test_weak_ref();
+	test_deferred_destruction();
+	test_biased_ref_count();
+	test_cycle_collector();
+	test_query_interface();
+	test_ref_count_policies();
+	test_atomic_com_ptr();
+#if BELT_HAS_REF_COOKIES
+	test_leak_detection();
+#endif
+	test_pooled();
+	test_create_instance_in();
+	test_class_registry();
+	test_class_factories();
+	test_single_cached_instance();
+	test_guid_generation();
+	test_multi_ptr();
+
+	return failures == 0 ? 0 : 1;
 }